@@ -61,6 +61,11 @@ namespace InventoryGameplayTags
 	UE_DEFINE_GAMEPLAY_TAG_COMMENT(SetByCaller_Damage, "SetByCaller.Damage", "SetByCaller tag used by damage gameplay effects.");
 	UE_DEFINE_GAMEPLAY_TAG_COMMENT(SetByCaller_Heal, "SetByCaller.Heal", "SetByCaller tag used by healing gameplay effects.");
 
+	UE_DEFINE_GAMEPLAY_TAG_COMMENT(Equipment_Stat_KineticArmor, "Equipment.Stat.KineticArmor", "Item stat added to the kinetic armor while the item is equipped.");
+	UE_DEFINE_GAMEPLAY_TAG_COMMENT(Equipment_Stat_EnergyArmor, "Equipment.Stat.EnergyArmor", "Item stat added to the energy armor while the item is equipped.");
+	UE_DEFINE_GAMEPLAY_TAG_COMMENT(Equipment_Stat_KineticResistance, "Equipment.Stat.KineticResistance", "Item stat added to the kinetic resistance while the item is equipped.");
+	UE_DEFINE_GAMEPLAY_TAG_COMMENT(Equipment_Stat_EnergyResistance, "Equipment.Stat.EnergyResistance", "Item stat added to the energy resistance while the item is equipped.");
+
 	UE_DEFINE_GAMEPLAY_TAG_COMMENT(Cheat_GodMode, "Cheat.GodMode", "GodMode cheat is active on the owner.");
 	UE_DEFINE_GAMEPLAY_TAG_COMMENT(Cheat_UnlimitedHealth, "Cheat.UnlimitedHealth", "UnlimitedHealth cheat is active on the owner.");
 	UE_DEFINE_GAMEPLAY_TAG_COMMENT(Cheat_UnlimitedEnergy, "Cheat.UnlimitedEnergy", "UnlimitedEnergy cheat is active on the owner.");
@@ -63,6 +63,12 @@ namespace InventoryGameplayTags
 	INVENTORYABILITYSYSTEM_API	UE_DECLARE_GAMEPLAY_TAG_EXTERN(SetByCaller_Damage);
 	INVENTORYABILITYSYSTEM_API	UE_DECLARE_GAMEPLAY_TAG_EXTERN(SetByCaller_Heal);
 
+	// item stat tags of equipped items, summed into the SetByCaller magnitudes of UInventoryGameplayEffect_EquipmentStats
+	INVENTORYABILITYSYSTEM_API	UE_DECLARE_GAMEPLAY_TAG_EXTERN(Equipment_Stat_KineticArmor);
+	INVENTORYABILITYSYSTEM_API	UE_DECLARE_GAMEPLAY_TAG_EXTERN(Equipment_Stat_EnergyArmor);
+	INVENTORYABILITYSYSTEM_API	UE_DECLARE_GAMEPLAY_TAG_EXTERN(Equipment_Stat_KineticResistance);
+	INVENTORYABILITYSYSTEM_API	UE_DECLARE_GAMEPLAY_TAG_EXTERN(Equipment_Stat_EnergyResistance);
+
 	INVENTORYABILITYSYSTEM_API	UE_DECLARE_GAMEPLAY_TAG_EXTERN(Cheat_GodMode);
 	INVENTORYABILITYSYSTEM_API	UE_DECLARE_GAMEPLAY_TAG_EXTERN(Cheat_UnlimitedHealth);
 	INVENTORYABILITYSYSTEM_API	UE_DECLARE_GAMEPLAY_TAG_EXTERN(Cheat_UnlimitedEnergy);
@@ -4,6 +4,7 @@
 #include "Ability/Execution/DamageExecution.h"
 #include "Ability/Attribute/InventoryCombatSet.h"
 #include "Ability/Attribute/InventoryHealthSet.h"
+#include "Ability/InventoryGameplayEffectContext.h"
 #include "Equipment/WeaponInstance.h"
 #include "GenericTeamAgentInterface.h"
 
@@ -101,21 +102,46 @@ void UDamageExecution::Execute_Implementation(const FGameplayEffectCustomExecuti
 	}
 
 	// Apply ability source modifiers
-	float PhysicalMaterialMultiplier = 1.0f;
-	float DistanceAttenuation = 1.0f;
-	if (UWeaponInstance* AbilitySource = Cast<UWeaponInstance>(TypedContext->GetSourceObject()))
+	UWeaponInstance* AbilitySource = Cast<UWeaponInstance>(TypedContext->GetSourceObject());
+	float HitMultiplier = 0.0f;
+	const FInventoryGameplayEffectContext* InventoryContext = FInventoryGameplayEffectContext::ExtractEffectContext(Spec.GetContext());
+	if (InventoryContext && InventoryContext->Hits.Num() > 0)
 	{
-		if (const UPhysicalMaterial* PhysMat = TypedContext->GetHitResult()->PhysMaterial.Get())
+		// the pellets of a frame summed by UWeaponHitQueueSubsystem, each one is attenuated by its own distance and surface
+		for (const FInventoryDamageHit& Hit : InventoryContext->Hits)
 		{
-			PhysicalMaterialMultiplier = AbilitySource->GetDamageMultiplier(PhysMat);
+			float PhysicalMaterialMultiplier = 1.0f;
+			float DistanceAttenuation = 1.0f;
+			if (AbilitySource)
+			{
+				if (const UPhysicalMaterial* PhysMat = Hit.PhysMaterial.Get())
+				{
+					PhysicalMaterialMultiplier = AbilitySource->GetDamageMultiplier(PhysMat);
+				}
+				DistanceAttenuation = AbilitySource->GetDamageAtDistance(Hit.Distance);
+			}
+			HitMultiplier += FMath::Max(DistanceAttenuation, 0.0f) * PhysicalMaterialMultiplier;
 		}
+	}
+	else
+	{
+		float PhysicalMaterialMultiplier = 1.0f;
+		float DistanceAttenuation = 1.0f;
+		if (AbilitySource)
+		{
+			// one lookup in the table of the weapon class, see UWeaponInstance::GetDamageMultiplier
+			if (const UPhysicalMaterial* PhysMat = HitActorResult ? HitActorResult->PhysMaterial.Get() : nullptr)
+			{
+				PhysicalMaterialMultiplier = AbilitySource->GetDamageMultiplier(PhysMat);
+			}
 
-		DistanceAttenuation = AbilitySource->GetDamageAtDistance(Distance);
+			DistanceAttenuation = AbilitySource->GetDamageAtDistance(Distance);
+		}
+		HitMultiplier = FMath::Max(DistanceAttenuation, 0.0f) * PhysicalMaterialMultiplier;
 	}
-	DistanceAttenuation = FMath::Max(DistanceAttenuation, 0.0f);
 
 	// Clamping is done when damage is converted to -health
-	const float DamageDone = FMath::Max(BaseDamage * DistanceAttenuation * PhysicalMaterialMultiplier * DamageInteractionAllowedMultiplier, 0.0f);
+	const float DamageDone = FMath::Max(BaseDamage * HitMultiplier * DamageInteractionAllowedMultiplier, 0.0f);
 
 	if (DamageDone > 0.0f)
 	{
@@ -0,0 +1,134 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Ability/InventoryGameplayAbilityTargetData_WeaponHits.h"
+#include "Engine/NetSerialization.h"
+#include "PhysicalMaterials/PhysicalMaterial.h"
+
+void FInventoryGameplayAbilityTargetData_WeaponHits::AddHit(const FHitResult& Hit, uint8 ShotIndex)
+{
+	if (Hits.Num() >= MaxHits)
+		return;
+
+	if (Hits.Num() == 0)
+		TraceStart = Hit.TraceStart;
+
+	FInventoryWeaponHit& NewHit = Hits.AddDefaulted_GetRef();
+	NewHit.Actor = Hit.GetActor();
+	NewHit.ImpactOffset = Hit.ImpactPoint - TraceStart;
+	NewHit.OriginOffset = Hit.TraceStart - TraceStart;
+	NewHit.ImpactNormal = Hit.ImpactNormal;
+	NewHit.PhysMaterial = Hit.PhysMaterial;
+	NewHit.ShotIndex = ShotIndex;
+}
+
+FHitResult FInventoryGameplayAbilityTargetData_WeaponHits::MakeHitResult(int32 HitIndex) const
+{
+	const FInventoryWeaponHit& Hit = Hits[HitIndex];
+
+	// the component isn't sent, the trace is considered to end at the impact
+	const FVector ImpactPoint = TraceStart + Hit.ImpactOffset;
+	FHitResult Result(Hit.Actor.Get(), nullptr, ImpactPoint, Hit.ImpactNormal);
+	Result.ImpactPoint = ImpactPoint;
+	Result.ImpactNormal = Hit.ImpactNormal;
+	Result.TraceStart = TraceStart + Hit.OriginOffset;
+	Result.TraceEnd = ImpactPoint;
+	Result.Distance = (Hit.ImpactOffset - Hit.OriginOffset).Size();
+	Result.PhysMaterial = Hit.PhysMaterial;
+	Result.bBlockingHit = true;
+	return Result;
+}
+
+void FInventoryGameplayAbilityTargetData_WeaponHits::ExpandHits(FGameplayAbilityTargetDataHandle& TargetData)
+{
+	for (int32 Index = TargetData.Data.Num() - 1; Index >= 0; --Index)
+	{
+		const FGameplayAbilityTargetData* Data = TargetData.Data[Index].Get();
+		if (!Data || Data->GetScriptStruct() != StaticStruct())
+			continue;
+
+		const FInventoryGameplayAbilityTargetData_WeaponHits WeaponHits = *static_cast<const FInventoryGameplayAbilityTargetData_WeaponHits*>(Data);
+		TargetData.Data.RemoveAt(Index);
+
+		for (int32 HitIndex = 0; HitIndex < WeaponHits.Hits.Num(); ++HitIndex)
+		{
+			FGameplayAbilityTargetData_SingleTargetHit* HitData = new FGameplayAbilityTargetData_SingleTargetHit(WeaponHits.MakeHitResult(HitIndex));
+			TargetData.Data.Insert(TSharedPtr<FGameplayAbilityTargetData>(HitData), Index + HitIndex);
+		}
+	}
+}
+
+TArray<TWeakObjectPtr<AActor>> FInventoryGameplayAbilityTargetData_WeaponHits::GetActors() const
+{
+	TArray<TWeakObjectPtr<AActor>> Actors;
+	for (const FInventoryWeaponHit& Hit : Hits)
+	{
+		if (Hit.Actor.IsValid())
+			Actors.AddUnique(Hit.Actor);
+	}
+	return Actors;
+}
+
+FString FInventoryGameplayAbilityTargetData_WeaponHits::ToString() const
+{
+	return FString::Printf(TEXT("FInventoryGameplayAbilityTargetData_WeaponHits (%d hits)"), Hits.Num());
+}
+
+bool FInventoryGameplayAbilityTargetData_WeaponHits::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	bOutSuccess = SerializePackedVector<1, 24>(TraceStart, Ar);
+
+	uint32 NumHits = Hits.Num();
+	Ar.SerializeIntPacked(NumHits);
+	if (Ar.IsLoading())
+	{
+		if (NumHits > MaxHits)
+		{
+			Ar.SetError();
+			bOutSuccess = false;
+			return false;
+		}
+		Hits.SetNum(NumHits);
+	}
+
+	// one bit for the common volley whose pellets all start at TraceStart
+	uint8 OriginsBit = 0;
+	if (Ar.IsSaving())
+		OriginsBit = Hits.ContainsByPredicate([](const FInventoryWeaponHit& Hit) { return !Hit.OriginOffset.IsNearlyZero(0.5); }) ? 1 : 0;
+	Ar.SerializeBits(&OriginsBit, 1);
+
+	uint8 SeededBit = bSeeded ? 1 : 0;
+	Ar.SerializeBits(&SeededBit, 1);
+	bSeeded = SeededBit != 0;
+	if (bSeeded)
+	{
+		// the seed isn't sent, the server derives it from AttackIndex
+		bOutSuccess &= SerializeFixedVector<1, 16>(AimDirection, Ar);
+		uint16 QuantizedSpread = (uint16)FMath::Clamp(FMath::RoundToInt(SpreadAngle * 100.0f), 0, MAX_uint16);
+		Ar << QuantizedSpread;
+		SpreadAngle = QuantizedSpread / 100.0f;
+
+		uint32 PackedAttackIndex = (uint32)FMath::Max(AttackIndex, 0);
+		Ar.SerializeIntPacked(PackedAttackIndex);
+		AttackIndex = (int32)FMath::Min(PackedAttackIndex, (uint32)MAX_int32);
+		uint32 ShotTimeMs = (uint32)FMath::Max(FMath::RoundToInt(ShotTime * 1000.0f), 0);
+		Ar.SerializeIntPacked(ShotTimeMs);
+		ShotTime = ShotTimeMs / 1000.0f;
+	}
+
+	for (FInventoryWeaponHit& Hit : Hits)
+	{
+		Ar << Hit.Actor;
+		// relative to the trace start, so a few bits per component cover the weapon range
+		bOutSuccess &= SerializePackedVector<1, 20>(Hit.ImpactOffset, Ar);
+		if (OriginsBit)
+			bOutSuccess &= SerializePackedVector<1, 20>(Hit.OriginOffset, Ar);
+		else if (Ar.IsLoading())
+			Hit.OriginOffset = FVector::ZeroVector;
+		bOutSuccess &= SerializeFixedVector<1, 8>(Hit.ImpactNormal, Ar);
+		Ar << Hit.PhysMaterial;
+		Ar << Hit.ShotIndex;
+	}
+
+	return true;
+}
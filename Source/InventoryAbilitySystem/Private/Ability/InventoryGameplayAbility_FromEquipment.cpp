@@ -4,6 +4,7 @@
 #include "Ability/InventoryGameplayAbility_FromEquipment.h"
 #include "Equipment/EquipmentInstance.h"
 #include "Inventory/InventoryItemInstance.h"
+#include "AbilitySystemComponent.h"
 
 #if WITH_EDITOR
 #include "Misc/DataValidation.h"
@@ -33,6 +34,22 @@ UInventoryItemInstance* UInventoryGameplayAbility_FromEquipment::GetAssociatedIt
 	return nullptr;
 }
 
+bool UInventoryGameplayAbility_FromEquipment::CanActivateAbility(const FGameplayAbilitySpecHandle Handle, const FGameplayAbilityActorInfo* ActorInfo, const FGameplayTagContainer* SourceTags, const FGameplayTagContainer* TargetTags, FGameplayTagContainer* OptionalRelevantTags) const
+{
+	if (ActorInfo && ActorInfo->AbilitySystemComponent.IsValid())
+	{
+		if (const FGameplayAbilitySpec* Spec = ActorInfo->AbilitySystemComponent->FindAbilitySpecFromHandle(Handle))
+		{
+			const UEquipmentInstance* Equipment = Cast<UEquipmentInstance>(Spec->SourceObject.Get());
+			if (Equipment && Equipment->IsDormant())
+			{
+				return false;
+			}
+		}
+	}
+
+	return Super::CanActivateAbility(Handle, ActorInfo, SourceTags, TargetTags, OptionalRelevantTags);
+}
 
 #if WITH_EDITOR
 EDataValidationResult UInventoryGameplayAbility_FromEquipment::IsDataValid(FDataValidationContext& Context) const
@@ -2,8 +2,39 @@
 
 
 #include "Ability/InventoryGameplayAbility_RangedWeapon.h"
+#include "Ability/InventoryGameplayAbilityTargetData_WeaponHits.h"
+#include "Ability/InventoryAbilitySystemComponent.h"
+#include "Ability/LagCompensationSubsystem.h"
 #include "Equipment/WeaponInstance.h"
+#include "Equipment/EquipmentComponent.h"
+#include "Equipment/ProjectileSubsystem.h"
 #include "AIController.h"
+#include "HAL/IConsoleManager.h"
+#include "TimerManager.h"
+
+namespace RangedWeaponValidation
+{
+	static float PelletTolerance = 1.0f;
+	static FAutoConsoleVariableRef CVarPelletTolerance(
+		TEXT("Inventory.Weapon.PelletTolerance"),
+		PelletTolerance,
+		TEXT("How far a hit may be from the direction the server regenerates for its pellet (in degrees)"),
+		ECVF_Default);
+
+	static float SpreadTolerance = 2.0f;
+	static FAutoConsoleVariableRef CVarSpreadTolerance(
+		TEXT("Inventory.Weapon.SpreadTolerance"),
+		SpreadTolerance,
+		TEXT("How far the spread a client fired with may be from the spread of the server (in degrees)"),
+		ECVF_Default);
+
+	static float FireTimeTolerance = 0.1f;
+	static FAutoConsoleVariableRef CVarFireTimeTolerance(
+		TEXT("Inventory.Weapon.FireTimeTolerance"),
+		FireTimeTolerance,
+		TEXT("How far ahead of the time the server spent in the activation a client attack may be stamped, covers network jitter (in seconds)"),
+		ECVF_Default);
+}
 
 bool UInventoryGameplayAbility_RangedWeapon::CanActivateAbility(const FGameplayAbilitySpecHandle Handle, const FGameplayAbilityActorInfo* ActorInfo, const FGameplayTagContainer* SourceTags, const FGameplayTagContainer* TargetTags, FGameplayTagContainer* OptionalRelevantTags) const
 {
@@ -12,17 +43,36 @@ bool UInventoryGameplayAbility_RangedWeapon::CanActivateAbility(const FGameplayA
 	if (bResult) {
 		URangedWeaponInstance* WeaponData = GetWeaponInstance<URangedWeaponInstance>();
 		check(WeaponData);
-		return !WeaponData->bWasOverheated;
+		return !WeaponData->IsOverheated();
 	}
 	return false;
 }
 
+void UInventoryGameplayAbility_RangedWeapon::ActivateAbility(const FGameplayAbilitySpecHandle Handle, const FGameplayAbilityActorInfo* ActorInfo, const FGameplayAbilityActivationInfo ActivationInfo, const FGameplayEventData* TriggerEventData)
+{
+	AttackIndex = 0;
+	LastValidatedAttackIndex = INDEX_NONE;
+	ActivationTime = GetWorld()->GetTimeSeconds();
+
+	Super::ActivateAbility(Handle, ActorInfo, ActivationInfo, TriggerEventData);
+}
+
+void UInventoryGameplayAbility_RangedWeapon::EndAbility(const FGameplayAbilitySpecHandle Handle, const FGameplayAbilityActorInfo* ActorInfo, const FGameplayAbilityActivationInfo ActivationInfo, bool bReplicateEndAbility, bool bWasCancelled)
+{
+	StopAutomaticFire();
+
+	Super::EndAbility(Handle, ActorInfo, ActivationInfo, bReplicateEndAbility, bWasCancelled);
+}
+
 void UInventoryGameplayAbility_RangedWeapon::PostCommitAbility()
 {
 	// We fired the weapon, add spread
 	URangedWeaponInstance* WeaponData = GetWeaponInstance<URangedWeaponInstance>();
 	check(WeaponData);
 	WeaponData->AddSpread();
+
+	// the next attack of the activation gets its own seed
+	++AttackIndex;
 }
 
 void UInventoryGameplayAbility_RangedWeapon::AddAdditionalTraceIgnoreActors(FCollisionQueryParams& TraceParams) const
@@ -43,14 +93,34 @@ ECollisionChannel UInventoryGameplayAbility_RangedWeapon::DetermineTraceChannel(
 
 FHitResult UInventoryGameplayAbility_RangedWeapon::WeaponTrace(const FVector& StartTrace, const FVector& EndTrace, float SweepRadius, bool bIsSimulated, TArray<FHitResult>& OutHitResults) const
 {
-	TArray<FHitResult> HitResults;
+	FCollisionQueryParams TraceParams;
+	const ECollisionChannel TraceChannel = InitTraceParams(TraceParams, bIsSimulated);
 
-	FCollisionQueryParams TraceParams(SCENE_QUERY_STAT(WeaponTrace), /*bTraceComplex=*/ true, /*IgnoreActor=*/ GetAvatarActorFromActorInfo());
+	// blueprints pass the hits of earlier traces in, those actors aren't hit again
+	FWeaponHitSet SeenHits;
+	for (const FHitResult& Hit : OutHitResults)
+	{
+		SeenHits.Add(Hit.HitObjectHandle);
+	}
+
+	// blueprints get the last collected hit back even if this trace only found actors hit before
+	const FHitResult Hit = WeaponTraceWithParams(StartTrace, EndTrace, SweepRadius, TraceChannel, TraceParams, SeenHits, OutHitResults);
+	return OutHitResults.Num() > 0 ? OutHitResults.Last() : Hit;
+}
+
+ECollisionChannel UInventoryGameplayAbility_RangedWeapon::InitTraceParams(FCollisionQueryParams& TraceParams, bool bIsSimulated) const
+{
+	TraceParams = FCollisionQueryParams(SCENE_QUERY_STAT(WeaponTrace), /*bTraceComplex=*/ true, /*IgnoreActor=*/ GetAvatarActorFromActorInfo());
 	TraceParams.bReturnPhysicalMaterial = true;
 	AddAdditionalTraceIgnoreActors(TraceParams);
 	//TraceParams.bDebugQuery = true;
 
-	const ECollisionChannel TraceChannel = DetermineTraceChannel(TraceParams, bIsSimulated);
+	return DetermineTraceChannel(TraceParams, bIsSimulated);
+}
+
+FHitResult UInventoryGameplayAbility_RangedWeapon::WeaponTraceWithParams(const FVector& StartTrace, const FVector& EndTrace, float SweepRadius, ECollisionChannel TraceChannel, const FCollisionQueryParams& TraceParams, FWeaponHitSet& SeenHits, TArray<FHitResult>& OutHitResults) const
+{
+	TArray<FHitResult> HitResults;
 
 	if (SweepRadius > 0.0f)
 	{
@@ -62,33 +132,344 @@ FHitResult UInventoryGameplayAbility_RangedWeapon::WeaponTrace(const FVector& St
 	}
 
 	FHitResult Hit(ForceInit);
-	if (HitResults.Num() > 0)
+	if (AddTraceHits(HitResults, SeenHits, OutHitResults) > 0)
+	{
+		Hit = OutHitResults.Last();
+	}
+	else
+	{
+		Hit.TraceStart = StartTrace;
+		Hit.TraceEnd = EndTrace;
+	}
+
+	return Hit;
+}
+
+int32 UInventoryGameplayAbility_RangedWeapon::AddTraceHits(const TArray<FHitResult>& TraceHits, FWeaponHitSet& SeenHits, TArray<FHitResult>& OutHitResults)
+{
+	// Filter the output list to prevent multiple hits on the same actor;
+	// this is to prevent a single bullet dealing damage multiple times to
+	// a single actor if using an overlap trace
+	int32 NumAdded = 0;
+	for (const FHitResult& CurHitResult : TraceHits)
+	{
+		bool bAlreadyHit = false;
+		SeenHits.Add(CurHitResult.HitObjectHandle, &bAlreadyHit);
+		if (!bAlreadyHit)
+		{
+			OutHitResults.Add(CurHitResult);
+			++NumAdded;
+		}
+	}
+	return NumAdded;
+}
+
+void UInventoryGameplayAbility_RangedWeapon::StartRangedWeaponTargeting(ETargetingSource Source)
+{
+	if (!ensureMsgf(Source != ETargetingSource::Custom, TEXT("%s can't target from a custom source natively, use PerformLocalTargeting"), *GetPathName()))
+		return;
+
+	URangedWeaponInstance* WeaponData = GetWeaponInstance<URangedWeaponInstance>();
+	check(WeaponData);
+
+	const FTransform TargetingTransform = GetTargetingTransform(Source);
+	const FVector StartTrace = TargetingTransform.GetLocation();
+	const TArray<FVector> Directions = GeneratePelletDirections(TargetingTransform.GetUnitAxis(EAxis::X));
+	const float MaxRange = WeaponData->GetMaxDamageRange();
+	const float SweepRadius = WeaponData->GetHitTraceRadius();
+
+	// ignored actors and channel are gathered once for the whole volley
+	FCollisionQueryParams TraceParams;
+	const ECollisionChannel TraceChannel = InitTraceParams(TraceParams, /*bIsSimulated=*/ false);
+
+	if (!bAsyncPelletTraces)
+	{
+		TArray<FHitResult> FoundHits;
+		TracePellets(StartTrace, Directions, TraceChannel, TraceParams, FoundHits);
+		SubmitWeaponHits(FoundHits);
+		return;
+	}
+
+	// results of a previous attack that are still in flight are dropped
+	++PelletTraceBatch;
+	NumPendingPelletTraces = Directions.Num();
+	PendingPelletHits.Reset();
+	PendingSeenHits.Reset();
+
+	FTraceDelegate TraceDelegate = FTraceDelegate::CreateUObject(this, &ThisClass::OnPelletTraceDone);
+	for (const FVector& Direction : Directions)
+	{
+		const FVector EndTrace = StartTrace + Direction * MaxRange;
+		if (SweepRadius > 0.0f)
+		{
+			GetWorld()->AsyncSweepByChannel(EAsyncTraceType::Multi, StartTrace, EndTrace, FQuat::Identity, TraceChannel, FCollisionShape::MakeSphere(SweepRadius), TraceParams, FCollisionResponseParams::DefaultResponseParam, &TraceDelegate, PelletTraceBatch);
+		}
+		else
+		{
+			GetWorld()->AsyncLineTraceByChannel(EAsyncTraceType::Multi, StartTrace, EndTrace, TraceChannel, TraceParams, FCollisionResponseParams::DefaultResponseParam, &TraceDelegate, PelletTraceBatch);
+		}
+	}
+
+	if (NumPendingPelletTraces == 0)
+		SubmitWeaponHits(PendingPelletHits);
+}
+
+void UInventoryGameplayAbility_RangedWeapon::TracePellets(const FVector& StartTrace, const TArray<FVector>& Directions, ECollisionChannel TraceChannel, const FCollisionQueryParams& TraceParams, TArray<FHitResult>& OutHits) const
+{
+	URangedWeaponInstance* WeaponData = GetWeaponInstance<URangedWeaponInstance>();
+	check(WeaponData);
+
+	const float MaxRange = WeaponData->GetMaxDamageRange();
+	const float SweepRadius = WeaponData->GetHitTraceRadius();
+
+	FWeaponHitSet SeenHits;
+	for (const FVector& Direction : Directions)
+	{
+		if (HitDeduplication == EWeaponHitDeduplication::PerPellet)
+			SeenHits.Reset();
+		WeaponTraceWithParams(StartTrace, StartTrace + Direction * MaxRange, SweepRadius, TraceChannel, TraceParams, SeenHits, OutHits);
+	}
+}
+
+void UInventoryGameplayAbility_RangedWeapon::OnPelletTraceDone(const FTraceHandle& TraceHandle, FTraceDatum& TraceDatum)
+{
+	if (TraceDatum.UserData != PelletTraceBatch || NumPendingPelletTraces <= 0)
+		return;
+
+	if (HitDeduplication == EWeaponHitDeduplication::PerPellet)
+		PendingSeenHits.Reset();
+	AddTraceHits(TraceDatum.OutHits, PendingSeenHits, PendingPelletHits);
+
+	if (--NumPendingPelletTraces == 0 && IsActive())
+		SubmitWeaponHits(PendingPelletHits);
+}
+
+void UInventoryGameplayAbility_RangedWeapon::StartAutomaticFire(ETargetingSource Source)
+{
+	if (!ensureMsgf(Source != ETargetingSource::Custom, TEXT("%s can't target from a custom source natively, use PerformLocalTargeting"), *GetPathName()))
+		return;
+
+	// the server checks the attacks the client sends instead of scheduling its own
+	if (!IsLocallyControlled() || bAutomaticFire)
+		return;
+
+	URangedWeaponInstance* WeaponData = GetWeaponInstance<URangedWeaponInstance>();
+	check(WeaponData);
+
+	AutomaticFireSource = Source;
+	bAutomaticFire = true;
+
+	// attacks already fired this activation keep their spacing, the server checks it from the activation on
+	NextAttackTime = FMath::Max(GetWorld()->GetTimeSeconds(), ActivationTime + AttackIndex * (double)WeaponData->GetFireInterval());
+	TickAutomaticFire();
+}
+
+void UInventoryGameplayAbility_RangedWeapon::StopAutomaticFire()
+{
+	bAutomaticFire = false;
+	if (AutomaticFireTimer.IsValid())
+	{
+		if (UWorld* World = GetWorld())
+			World->GetTimerManager().ClearTimer(AutomaticFireTimer);
+		AutomaticFireTimer.Invalidate();
+	}
+}
+
+void UInventoryGameplayAbility_RangedWeapon::TickAutomaticFire()
+{
+	AutomaticFireTimer.Invalidate();
+	if (!bAutomaticFire || !IsActive())
+		return;
+
+	URangedWeaponInstance* WeaponData = GetWeaponInstance<URangedWeaponInstance>();
+	check(WeaponData);
+
+	UAbilitySystemComponent* MyAbilityComponent = CurrentActorInfo->AbilitySystemComponent.Get();
+	check(MyAbilityComponent);
+
+	const double Now = GetWorld()->GetTimeSeconds();
+	const double Interval = WeaponData->GetFireInterval();
+
+	// after a hitch only the latest MaxAttacksPerFrame attacks are fired, still spaced by the interval
+	const int32 MaxAttacks = WeaponData->GetMaxAttacksPerFrame();
+	NextAttackTime = FMath::Max(NextAttackTime, Now - Interval * (MaxAttacks - 1));
+
+	if (NextAttackTime <= Now)
 	{
-		// Filter the output list to prevent multiple hits on the same actor;
-		// this is to prevent a single bullet dealing damage multiple times to
-		// a single actor if using an overlap trace
-		for (FHitResult& CurHitResult : HitResults)
+		FScopedPredictionWindow ScopedPrediction(MyAbilityComponent, CurrentActivationInfo.GetActivationPredictionKey());
+
+		// the aim and the ignored actors are only gathered once per frame, every attack of the frame shares them
+		const FTransform TargetingTransform = GetTargetingTransform(AutomaticFireSource);
+		FCollisionQueryParams TraceParams;
+		const ECollisionChannel TraceChannel = InitTraceParams(TraceParams, /*bIsSimulated=*/ false);
+
+		FGameplayAbilityTargetDataHandle TargetData;
+		bool bCommitFailed = false;
 		{
-			auto Pred = [&CurHitResult](const FHitResult& Other)
+			FScopedPredictionWindow ScopedAttackPrediction(MyAbilityComponent);
+			while (NextAttackTime <= Now)
+			{
+				if (WeaponData->IsOverheated() || !CommitAbility(CurrentSpecHandle, CurrentActorInfo, CurrentActivationInfo))
 				{
-					return Other.HitObjectHandle == CurHitResult.HitObjectHandle;
-				};
+					bCommitFailed = true;
+					break;
+				}
+
+				// the pellets use the spread left by the previous attack, the heat step comes after
+				const TArray<FVector> Directions = GeneratePelletDirections(TargetingTransform.GetUnitAxis(EAxis::X));
+				AttackShotTime = (float)(NextAttackTime - ActivationTime);
+				TArray<FHitResult> FoundHits;
+				TracePellets(TargetingTransform.GetLocation(), Directions, TraceChannel, TraceParams, FoundHits);
+
+				// every attack gets an entry even without hits, the server commits one attack per entry
+				FInventoryGameplayAbilityTargetData_WeaponHits* AttackData = new FInventoryGameplayAbilityTargetData_WeaponHits();
+				BuildWeaponHits(FoundHits, *AttackData);
+				TargetData.Add(AttackData);
+
+				PostCommitAbility();
+				NextAttackTime += Interval;
+			}
+		}
+
+		if (TargetData.Num() > 0)
+		{
+			WeaponData->UpdateUseTime();
+			ProcessWeaponTargetData(TargetData, FGameplayTag(), /*bShotsCommitted=*/ true);
+		}
+
+		if (bCommitFailed && IsActive())
+		{
+			UE_LOG(LogInventoryAbilitySystem, Verbose, TEXT("Weapon ability %s stopped automatic fire, the next attack failed to commit"), *GetPathName());
+			K2_EndAbility();
+			return;
+		}
+	}
+
+	if (bAutomaticFire && IsActive())
+		AutomaticFireTimer = GetWorld()->GetTimerManager().SetTimerForNextTick(this, &ThisClass::TickAutomaticFire);
+}
+
+void UInventoryGameplayAbility_RangedWeapon::FireProjectiles(ETargetingSource Source)
+{
+	if (!ensureMsgf(Source != ETargetingSource::Custom, TEXT("%s can't fire from a custom source natively"), *GetPathName()))
+		return;
 
-			if (!OutHitResults.ContainsByPredicate(Pred))
+	// the server launches the volley of a remote client once its target data arrives, see OnTargetDataReadyCallback
+	if (!CurrentActorInfo->IsLocallyControlled())
+		return;
+
+	URangedWeaponInstance* WeaponData = GetWeaponInstance<URangedWeaponInstance>();
+	check(WeaponData);
+
+	if (!ensureMsgf(WeaponData->GetProjectileDefinition(), TEXT("%s fires projectiles but %s has no ProjectileDefinition"), *GetPathName(), *GetPathNameSafe(WeaponData)))
+		return;
+
+	// fills in the aim, spread and shot time of the attack, LaunchProjectiles samples the same pellets from them
+	const FTransform TargetingTransform = GetTargetingTransform(Source);
+	GeneratePelletDirections(TargetingTransform.GetUnitAxis(EAxis::X));
+	PelletDirections.Reset();
+
+	if (!CurrentActorInfo->IsNetAuthority())
+	{
+		// the volley without hits, the server regenerates the pellets from the aim and the seed of the attack
+		FInventoryGameplayAbilityTargetData_WeaponHits* Volley = new FInventoryGameplayAbilityTargetData_WeaponHits();
+		Volley->TraceStart = TargetingTransform.GetLocation();
+		Volley->bSeeded = true;
+		Volley->AimDirection = AttackAimDirection;
+		Volley->SpreadAngle = AttackSpreadAngle;
+		Volley->AttackIndex = AttackIndex;
+		Volley->ShotTime = AttackShotTime;
+
+		FGameplayAbilityTargetDataHandle TargetData;
+		TargetData.UniqueId = 0;
+		TargetData.Add(Volley);
+
+		UAbilitySystemComponent* MyAbilityComponent = CurrentActorInfo->AbilitySystemComponent.Get();
+		FScopedPredictionWindow ScopedPrediction(MyAbilityComponent, CurrentActivationInfo.GetActivationPredictionKey());
+		MyAbilityComponent->CallServerSetReplicatedTargetData(CurrentSpecHandle, CurrentActivationInfo.GetActivationPredictionKey(), TargetData, FGameplayTag(), MyAbilityComponent->ScopedPredictionKey);
+	}
+
+	LaunchProjectiles(TargetingTransform.GetLocation(), AttackAimDirection, AttackSpreadAngle, GetAttackSeed());
+}
+
+void UInventoryGameplayAbility_RangedWeapon::OnTargetDataReadyCallback(const FGameplayAbilityTargetDataHandle& InData, FGameplayTag ApplicationTag)
+{
+	URangedWeaponInstance* WeaponData = GetWeaponInstance<URangedWeaponInstance>();
+	if (!WeaponData || !WeaponData->GetProjectileDefinition() || !CurrentActorInfo->IsNetAuthority() || CurrentActorInfo->IsLocallyControlled())
+	{
+		Super::OnTargetDataReadyCallback(InData, ApplicationTag);
+		return;
+	}
+
+	UAbilitySystemComponent* MyAbilityComponent = CurrentActorInfo->AbilitySystemComponent.Get();
+	check(MyAbilityComponent);
+
+	{
+		FScopedPredictionWindow ScopedPrediction(MyAbilityComponent);
+
+		const ULagCompensationSubsystem* LagCompensation = UWorld::GetSubsystem<ULagCompensationSubsystem>(GetWorld());
+		const APawn* Shooter = Cast<APawn>(GetAvatarActorFromActorInfo());
+		const double RewindTime = LagCompensation && Shooter ? LagCompensation->GetRewindTime(Shooter->GetController()) : 0.0;
+
+		FGameplayAbilityTargetDataHandle LocalTargetDataHandle(MoveTemp(const_cast<FGameplayAbilityTargetDataHandle&>(InData)));
+		for (const TSharedPtr<FGameplayAbilityTargetData>& Data : LocalTargetDataHandle.Data)
+		{
+			if (!Data.IsValid() || Data->GetScriptStruct() != FInventoryGameplayAbilityTargetData_WeaponHits::StaticStruct())
+				continue;
+
+			// like a rejected hitscan shot, a forged volley is paid for but launches nothing
+			FInventoryGameplayAbilityTargetData_WeaponHits& Volley = *static_cast<FInventoryGameplayAbilityTargetData_WeaponHits*>(Data.Get());
+			const bool bIsVolleyValid = Volley.bSeeded && ValidateWeaponHits(Volley) && (!LagCompensation || LagCompensation->IsValidOrigin(Volley.TraceStart, Shooter, RewindTime));
+
+			if (bIsVolleyValid)
 			{
-				OutHitResults.Add(CurHitResult);
+				if (!LaunchProjectiles(Volley.TraceStart, Volley.AimDirection.GetSafeNormal(), Volley.SpreadAngle, GetAttackSeed(Volley.AttackIndex)))
+					break;
+			}
+			else
+			{
+				UE_LOG(LogInventoryAbilitySystem, Warning, TEXT("Weapon ability %s dropped a volley of %s"), *GetPathName(), *GetNameSafe(Shooter));
+				if (!CommitAbility(CurrentSpecHandle, CurrentActorInfo, CurrentActivationInfo))
+				{
+					K2_EndAbility();
+					break;
+				}
+				PostCommitAbility();
 			}
 		}
+	}
 
-		Hit = OutHitResults.Last();
+	// We've processed the data
+	MyAbilityComponent->ConsumeClientReplicatedTargetData(CurrentSpecHandle, CurrentActivationInfo.GetActivationPredictionKey());
+}
+
+bool UInventoryGameplayAbility_RangedWeapon::LaunchProjectiles(const FVector& Origin, const FVector& AimDir, float SpreadAngle, int32 AttackSeed)
+{
+	if (!CommitAbility(CurrentSpecHandle, CurrentActorInfo, CurrentActivationInfo))
+	{
+		K2_EndAbility();
+		return false;
 	}
-	else
+	PostCommitAbility();
+
+	URangedWeaponInstance* WeaponData = GetWeaponInstance<URangedWeaponInstance>();
+	const int32 NumPellets = FMath::Clamp(WeaponData->GetHitsPerAttack(), 0, (int32)MAX_uint8);
+	if (UProjectileSubsystem* Projectiles = GetWorld()->GetSubsystem<UProjectileSubsystem>())
 	{
-		Hit.TraceStart = StartTrace;
-		Hit.TraceEnd = EndTrace;
+		for (int32 ShotIndex = 0; ShotIndex < NumPellets; ++ShotIndex)
+		{
+			const FVector Direction = SampleSpreadCone(AimDir, SpreadAngle * 0.5f, WeaponData->GetSpreadExponent(), GetShotSeed(AttackSeed, ShotIndex));
+			Projectiles->SpawnProjectile(WeaponData->GetProjectileDefinition(), Origin, Direction, WeaponData, GetAbilitySystemComponentFromActorInfo());
+		}
 	}
 
-	return Hit;
+	// the other clients simulate a cosmetic copy from the same parameters
+	if (CurrentActorInfo->IsNetAuthority())
+	{
+		if (UEquipmentComponent* Equipment = GetAvatarActorFromActorInfo()->FindComponentByClass<UEquipmentComponent>())
+			Equipment->MulticastProjectileVolley(WeaponData->GetProjectileDefinition(), Origin, AimDir, SpreadAngle, WeaponData->GetSpreadExponent(), (uint8)NumPellets, AttackSeed);
+	}
+	return true;
 }
 
 FTransform UInventoryGameplayAbility_RangedWeapon::GetTargetingTransform(ETargetingSource source)
@@ -172,3 +553,209 @@ FTransform UInventoryGameplayAbility_RangedWeapon::GetTargetingTransform(ETarget
 	// If we got here, either we don't have a camera or we don't want to use it, either way go forward
 	return FTransform(AimQuat, SourceLoc);
 }
+
+int32 UInventoryGameplayAbility_RangedWeapon::GetAttackSeed(int32 InAttackIndex) const
+{
+	const uint32 KeyHash = GetTypeHash(CurrentActivationInfo.GetActivationPredictionKey().Current);
+	return (int32)(InAttackIndex == 0 ? KeyHash : HashCombine(KeyHash, (uint32)InAttackIndex));
+}
+
+FVector UInventoryGameplayAbility_RangedWeapon::SampleSpreadCone(const FVector& AimDir, float HalfAngleDegrees, float Exponent, int32 Seed)
+{
+	if (HalfAngleDegrees <= 0.0f)
+		return AimDir.GetSafeNormal();
+
+	FRandomStream Stream(Seed);
+
+	// a rotation away from the center line followed by one around it, the exponent clusters the pellets towards the center
+	const float AngleFromCenter = FMath::Pow(Stream.FRand(), Exponent) * HalfAngleDegrees;
+	const float AngleAround = Stream.FRand() * 360.0f;
+
+	FQuat Direction = FQuat(AimDir.Rotation()) * FQuat(FRotator(0.0f, 0.0f, AngleAround)) * FQuat(FRotator(0.0f, AngleFromCenter, 0.0f));
+	Direction.Normalize();
+	return Direction.GetForwardVector();
+}
+
+TArray<FVector> UInventoryGameplayAbility_RangedWeapon::GeneratePelletDirections(const FVector& AimDir)
+{
+	URangedWeaponInstance* WeaponData = GetWeaponInstance<URangedWeaponInstance>();
+	check(WeaponData);
+
+	// sampled with the precision the spread is sent with, so the server regenerates the same cone
+	AttackSpreadAngle = FMath::RoundToFloat(WeaponData->GetSpreadAngle(false) * 100.0f) / 100.0f;
+	AttackAimDirection = AimDir.GetSafeNormal();
+	AttackShotTime = (float)(GetWorld()->GetTimeSeconds() - ActivationTime);
+
+	const int32 AttackSeed = GetAttackSeed();
+	PelletDirections.Reset(WeaponData->GetHitsPerAttack());
+	for (int32 ShotIndex = 0; ShotIndex < WeaponData->GetHitsPerAttack(); ++ShotIndex)
+	{
+		PelletDirections.Add(SampleSpreadCone(AttackAimDirection, AttackSpreadAngle * 0.5f, WeaponData->GetSpreadExponent(), GetShotSeed(AttackSeed, ShotIndex)));
+	}
+	return PelletDirections;
+}
+
+void UInventoryGameplayAbility_RangedWeapon::BuildWeaponHits(const TArray<FHitResult>& FoundHits, FInventoryGameplayAbilityTargetData_WeaponHits& OutWeaponHits)
+{
+	if (PelletDirections.Num() == 0)
+	{
+		// blueprint randomized the pellets itself
+		Super::BuildWeaponHits(FoundHits, OutWeaponHits);
+		return;
+	}
+
+	OutWeaponHits.bSeeded = true;
+	OutWeaponHits.AimDirection = AttackAimDirection;
+	OutWeaponHits.SpreadAngle = AttackSpreadAngle;
+	OutWeaponHits.AttackIndex = AttackIndex;
+	OutWeaponHits.ShotTime = AttackShotTime;
+
+	// the pellet of a hit is the one pointing closest to it, penetrating pellets can have several hits
+	for (const FHitResult& Hit : FoundHits)
+	{
+		const FVector HitDir = (Hit.ImpactPoint - Hit.TraceStart).GetSafeNormal();
+		int32 ShotIndex = 0;
+		double BestDot = -2.0;
+		for (int32 PelletIndex = 0; PelletIndex < PelletDirections.Num(); ++PelletIndex)
+		{
+			const double Dot = PelletDirections[PelletIndex] | HitDir;
+			if (Dot > BestDot)
+			{
+				BestDot = Dot;
+				ShotIndex = PelletIndex;
+			}
+		}
+		OutWeaponHits.AddHit(Hit, (uint8)FMath::Min(ShotIndex, 255));
+	}
+
+	PelletDirections.Reset();
+}
+
+bool UInventoryGameplayAbility_RangedWeapon::ValidateWeaponHits(FInventoryGameplayAbilityTargetData_WeaponHits& WeaponHits)
+{
+	using namespace RangedWeaponValidation;
+
+	if (!WeaponHits.bSeeded)
+		return true;
+
+	URangedWeaponInstance* WeaponData = GetWeaponInstance<URangedWeaponInstance>();
+	check(WeaponData);
+
+	// attacks come in order, at most one per fire interval since the activation and not ahead of the time the server spent in it
+	const double ServerTime = GetWorld()->GetTimeSeconds() - ActivationTime;
+	// the shot time is sent in milliseconds
+	const double EarliestTime = WeaponHits.AttackIndex * (double)WeaponData->GetFireInterval() - 0.001;
+	if (WeaponHits.AttackIndex <= LastValidatedAttackIndex || WeaponHits.ShotTime < EarliestTime || WeaponHits.ShotTime > ServerTime + FireTimeTolerance)
+	{
+		UE_LOG(LogInventoryAbilitySystem, Warning, TEXT("Weapon ability %s rejected attack %d at %fs, faster than the fire rate (last attack %d, %fs into the activation)"),
+			*GetPathName(), WeaponHits.AttackIndex, WeaponHits.ShotTime, LastValidatedAttackIndex, ServerTime);
+		return false;
+	}
+	if (FMath::Abs(WeaponHits.SpreadAngle - WeaponData->GetSpreadAngle(false)) > SpreadTolerance)
+	{
+		UE_LOG(LogInventoryAbilitySystem, Warning, TEXT("Weapon ability %s rejected a shot, spread %f is too far from %f"), *GetPathName(), WeaponHits.SpreadAngle, WeaponData->GetSpreadAngle(false));
+		return false;
+	}
+	LastValidatedAttackIndex = WeaponHits.AttackIndex;
+
+	// regenerate the pellet of every hit from the seed of the attack, the hit has to lie along it within the trace radius
+	const int32 AttackSeed = GetAttackSeed(WeaponHits.AttackIndex);
+	for (int32 HitIndex = WeaponHits.Hits.Num() - 1; HitIndex >= 0; --HitIndex)
+	{
+		const FInventoryWeaponHit& Hit = WeaponHits.Hits[HitIndex];
+		if (Hit.ShotIndex >= WeaponData->GetHitsPerAttack())
+		{
+			WeaponHits.Hits.RemoveAt(HitIndex);
+			continue;
+		}
+
+		const FVector Expected = SampleSpreadCone(WeaponHits.AimDirection, WeaponHits.SpreadAngle * 0.5f, WeaponData->GetSpreadExponent(), GetShotSeed(AttackSeed, Hit.ShotIndex));
+		const FVector ToImpact = Hit.ImpactOffset - Hit.OriginOffset;
+		const double Distance = ToImpact.Size();
+		const double AllowedDegrees = PelletTolerance + (Distance > UE_KINDA_SMALL_NUMBER ? FMath::RadiansToDegrees(FMath::Atan(WeaponData->GetHitTraceRadius() / Distance)) : 180.0);
+		const double Degrees = FMath::RadiansToDegrees(FMath::Acos(FMath::Clamp(Expected | (ToImpact / FMath::Max(Distance, UE_KINDA_SMALL_NUMBER)), -1.0, 1.0)));
+		if (Degrees > AllowedDegrees)
+		{
+			UE_LOG(LogInventoryAbilitySystem, Verbose, TEXT("Weapon ability %s dropped a hit of pellet %d, %f degrees off"), *GetPathName(), Hit.ShotIndex, Degrees);
+			WeaponHits.Hits.RemoveAt(HitIndex);
+		}
+	}
+
+	return true;
+}
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommandWithWorldAndArgs BenchmarkHitDeduplicationCommand(
+	TEXT("Inventory.Weapon.BenchmarkHitDedup"),
+	TEXT("Times the per volley hit deduplication of sweeps through a crowd, linear search against the hash set. Args: NumActors HitsPerSweep Pellets Iterations"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			if (!World)
+				return;
+
+			const int32 NumActors = FMath::Max(Args.IsValidIndex(0) ? FCString::Atoi(*Args[0]) : 100, 1);
+			const int32 HitsPerSweep = FMath::Max(Args.IsValidIndex(1) ? FCString::Atoi(*Args[1]) : 64, 1);
+			const int32 NumPellets = FMath::Max(Args.IsValidIndex(2) ? FCString::Atoi(*Args[2]) : 12, 1);
+			const int32 Iterations = FMath::Max(Args.IsValidIndex(3) ? FCString::Atoi(*Args[3]) : 1000, 1);
+
+			// bare actors stand in for the crowd, sweeps return several components of the same actor
+			FActorSpawnParameters SpawnParams;
+			SpawnParams.ObjectFlags |= RF_Transient;
+			TArray<AActor*> Crowd;
+			for (int32 Index = 0; Index < NumActors; ++Index)
+			{
+				Crowd.Add(World->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, SpawnParams));
+			}
+
+			FRandomStream Stream(0);
+			TArray<TArray<FHitResult>> Sweeps;
+			Sweeps.SetNum(NumPellets);
+			for (TArray<FHitResult>& Sweep : Sweeps)
+			{
+				for (int32 Index = 0; Index < HitsPerSweep; ++Index)
+				{
+					FHitResult& Hit = Sweep.AddDefaulted_GetRef();
+					Hit.HitObjectHandle = FActorInstanceHandle(Crowd[Stream.RandHelper(NumActors)]);
+				}
+			}
+
+			int32 NumLinearHits = 0;
+			double StartTime = FPlatformTime::Seconds();
+			for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+			{
+				TArray<FHitResult> OutHits;
+				for (const TArray<FHitResult>& Sweep : Sweeps)
+				{
+					for (const FHitResult& Hit : Sweep)
+					{
+						if (!OutHits.ContainsByPredicate([&Hit](const FHitResult& Other) { return Other.HitObjectHandle == Hit.HitObjectHandle; }))
+							OutHits.Add(Hit);
+					}
+				}
+				NumLinearHits += OutHits.Num();
+			}
+			const double LinearTime = FPlatformTime::Seconds() - StartTime;
+
+			int32 NumSetHits = 0;
+			StartTime = FPlatformTime::Seconds();
+			for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+			{
+				TArray<FHitResult> OutHits;
+				FWeaponHitSet SeenHits;
+				for (const TArray<FHitResult>& Sweep : Sweeps)
+				{
+					UInventoryGameplayAbility_RangedWeapon::AddTraceHits(Sweep, SeenHits, OutHits);
+				}
+				NumSetHits += OutHits.Num();
+			}
+			const double SetTime = FPlatformTime::Seconds() - StartTime;
+
+			for (AActor* Actor : Crowd)
+			{
+				Actor->Destroy();
+			}
+
+			UE_LOG(LogInventoryAbilitySystem, Display, TEXT("Hit dedup of %d pellets x %d hits over %d actors: linear %.2f us, hash set %.2f us per volley (%d / %d hits kept)"),
+				NumPellets, HitsPerSweep, NumActors, LinearTime * 1e6 / Iterations, SetTime * 1e6 / Iterations, NumLinearHits / Iterations, NumSetHits / Iterations);
+		}));
+#endif
@@ -4,6 +4,9 @@
 #include "Ability/InventoryGameplayAbility_Weapon.h"
 #include "Equipment/WeaponInstance.h"
 #include "Ability/InventoryAbilitySystemComponent.h"
+#include "Ability/LagCompensationSubsystem.h"
+#include "Ability/InventoryGameplayAbilityTargetData_WeaponHits.h"
+#include "Ability/WeaponHitQueueSubsystem.h"
 #include "AbilitySystemComponent.h"
 #include "CoreMinimal.h"
 #include "NativeGameplayTags.h"
@@ -103,6 +106,11 @@ void UInventoryGameplayAbility_Weapon::EndAbility(const FGameplayAbilitySpecHand
 }
 
 void UInventoryGameplayAbility_Weapon::OnTargetDataReadyCallback(const FGameplayAbilityTargetDataHandle& InData, FGameplayTag ApplicationTag)
+{
+	ProcessWeaponTargetData(InData, ApplicationTag, /*bShotsCommitted=*/ false);
+}
+
+void UInventoryGameplayAbility_Weapon::ProcessWeaponTargetData(const FGameplayAbilityTargetDataHandle& InData, FGameplayTag ApplicationTag, bool bShotsCommitted)
 {
 	UAbilitySystemComponent* MyAbilityComponent = CurrentActorInfo->AbilitySystemComponent.Get();
 	check(MyAbilityComponent);
@@ -120,19 +128,60 @@ void UInventoryGameplayAbility_Weapon::OnTargetDataReadyCallback(const FGameplay
 			MyAbilityComponent->CallServerSetReplicatedTargetData(CurrentSpecHandle, CurrentActivationInfo.GetActivationPredictionKey(), LocalTargetDataHandle, ApplicationTag, MyAbilityComponent->ScopedPredictionKey);
 		}
 
-		const bool bIsTargetDataValid = true;
+		// every shot is checked and committed in order, so the server steps the heat between the shots of a batch like the client did
+		TArray<FGameplayAbilityTargetDataHandle> Shots = SplitShots(LocalTargetDataHandle);
+		FGameplayAbilityTargetDataHandle CommittedTargetData;
+		int32 NumCommitted = 0;
+		int32 NumRejected = 0;
+		for (FGameplayAbilityTargetDataHandle& Shot : Shots)
+		{
+			// hits sent by a remote client are checked against where the targets were when it fired
+			const bool bIsShotValid = !CurrentActorInfo->IsNetAuthority() || CurrentActorInfo->IsLocallyControlled() || ValidateTargetData(Shot);
+
+			// See if we still have required ressources
+			if (!bShotsCommitted && !CommitAbility(CurrentSpecHandle, CurrentActorInfo, CurrentActivationInfo))
+				break;
+			if (!bShotsCommitted)
+				PostCommitAbility();
+			++NumCommitted;
+
+			// a rejected shot is paid for like on the client, but hits nothing and the following shots still count
+			if (bIsShotValid)
+				CommittedTargetData.Append(Shot);
+			else
+				++NumRejected;
+		}
+
+		if (NumRejected > 0)
+		{
+			UE_LOG(LogInventoryAbilitySystem, Warning, TEXT("Weapon ability %s dropped %d of %d shots of %s"), *GetPathName(), NumRejected, Shots.Num(), *GetNameSafe(GetAvatarActorFromActorInfo()));
+		}
 
-		// See if we still have required ressources
-		if (bIsTargetDataValid && CommitAbility(CurrentSpecHandle, CurrentActorInfo, CurrentActivationInfo))
+		if (NumCommitted > NumRejected)
 		{
-			PostCommitAbility();
+			// the volley is only packed for the wire, blueprints work on one target data per hit
+			FInventoryGameplayAbilityTargetData_WeaponHits::ExpandHits(CommittedTargetData);
+
+			if (HitDamageEffect && CurrentActorInfo->IsNetAuthority())
+			{
+				if (UWeaponHitQueueSubsystem* HitQueue = UWorld::GetSubsystem<UWeaponHitQueueSubsystem>(GetWorld()))
+				{
+					UWeaponInstance* WeaponData = GetWeaponInstance<UWeaponInstance>();
+					for (const TSharedPtr<FGameplayAbilityTargetData>& Data : CommittedTargetData.Data)
+					{
+						if (const FHitResult* Hit = Data.IsValid() ? Data->GetHitResult() : nullptr)
+							HitQueue->QueueHit(MyAbilityComponent, this, WeaponData, HitDamageEffect, GetAbilityLevel(), *Hit);
+					}
+				}
+			}
 
 			// Let the blueprint do stuff like apply effects to the targets
-			OnWeaponTargetDataReady(LocalTargetDataHandle);
+			OnWeaponTargetDataReady(CommittedTargetData);
 		}
-		else
+
+		if (NumCommitted < Shots.Num())
 		{
-			UE_LOG(LogInventoryAbilitySystem, Warning, TEXT("Weapon ability %s failed to commit (bIsTargetDataValid=%d)"), *GetPathName(), bIsTargetDataValid ? 1 : 0);
+			UE_LOG(LogInventoryAbilitySystem, Warning, TEXT("Weapon ability %s failed to commit (%d of %d shots committed)"), *GetPathName(), NumCommitted, Shots.Num());
 			K2_EndAbility();
 		}
 	}
@@ -141,13 +190,101 @@ void UInventoryGameplayAbility_Weapon::OnTargetDataReadyCallback(const FGameplay
 	MyAbilityComponent->ConsumeClientReplicatedTargetData(CurrentSpecHandle, CurrentActivationInfo.GetActivationPredictionKey());
 }
 
+TArray<FGameplayAbilityTargetDataHandle> UInventoryGameplayAbility_Weapon::SplitShots(const FGameplayAbilityTargetDataHandle& TargetData)
+{
+	TArray<FGameplayAbilityTargetDataHandle> Shots;
+	Shots.AddDefaulted();
+
+	// every WeaponHits entry past the first starts a shot, other target data goes with the shot before it
+	bool bFirstShot = true;
+	for (const TSharedPtr<FGameplayAbilityTargetData>& Data : TargetData.Data)
+	{
+		if (Data.IsValid() && Data->GetScriptStruct() == FInventoryGameplayAbilityTargetData_WeaponHits::StaticStruct())
+		{
+			if (!bFirstShot)
+				Shots.AddDefaulted();
+			bFirstShot = false;
+		}
+		Shots.Last().Data.Add(Data);
+	}
+	Shots.Last().UniqueId = TargetData.UniqueId;
+	return Shots;
+}
+
+bool UInventoryGameplayAbility_Weapon::ValidateTargetData(FGameplayAbilityTargetDataHandle& TargetData)
+{
+	const ULagCompensationSubsystem* LagCompensation = UWorld::GetSubsystem<ULagCompensationSubsystem>(GetWorld());
+	const APawn* Shooter = Cast<APawn>(GetAvatarActorFromActorInfo());
+	if (!LagCompensation || !Shooter)
+		return true;
+
+	const double RewindTime = LagCompensation->GetRewindTime(Shooter->GetController());
+	UWeaponInstance* WeaponData = GetWeaponInstance<UWeaponInstance>();
+	const float MaxRange = WeaponData ? WeaponData->GetMaxDamageRange() : 0.0f;
+
+	// false if the whole shot has to be rejected, otherwise OutbKeep tells if the hit stays
+	auto CheckHit = [&](const FHitResult& Hit, bool& OutbKeep)
+		{
+			const ELagCompensatedHit Result = LagCompensation->ValidateHit(Hit, Shooter, RewindTime, MaxRange);
+			if (Result == ELagCompensatedHit::InvalidOrigin)
+			{
+				UE_LOG(LogInventoryAbilitySystem, Warning, TEXT("Weapon ability %s rejected a shot of %s, the trace starts too far from the shooter"), *GetPathName(), *GetNameSafe(Shooter));
+				return false;
+			}
+			OutbKeep = Result == ELagCompensatedHit::Valid;
+			if (!OutbKeep)
+			{
+				UE_LOG(LogInventoryAbilitySystem, Verbose, TEXT("Weapon ability %s dropped a hit on %s (%s)"), *GetPathName(), *GetNameSafe(Hit.GetActor()),
+					Result == ELagCompensatedHit::Occluded ? TEXT("occluded") : TEXT("out of reach"));
+			}
+			return true;
+		};
+
+	for (int32 Index = TargetData.Data.Num() - 1; Index >= 0; --Index)
+	{
+		FGameplayAbilityTargetData* Data = TargetData.Data[Index].Get();
+		if (!Data)
+			continue;
+
+		bool bKeep = true;
+		if (Data->GetScriptStruct() == FInventoryGameplayAbilityTargetData_WeaponHits::StaticStruct())
+		{
+			FInventoryGameplayAbilityTargetData_WeaponHits& WeaponHits = *static_cast<FInventoryGameplayAbilityTargetData_WeaponHits*>(Data);
+			if (!ValidateWeaponHits(WeaponHits))
+				return false;
+
+			for (int32 HitIndex = WeaponHits.Hits.Num() - 1; HitIndex >= 0; --HitIndex)
+			{
+				if (!CheckHit(WeaponHits.MakeHitResult(HitIndex), bKeep))
+					return false;
+				if (!bKeep)
+					WeaponHits.Hits.RemoveAt(HitIndex);
+			}
+		}
+		else if (const FHitResult* Hit = Data->GetHitResult())
+		{
+			if (!CheckHit(*Hit, bKeep))
+				return false;
+			if (!bKeep)
+				TargetData.Data.RemoveAt(Index);
+		}
+	}
+
+	return true;
+}
+
+void UInventoryGameplayAbility_Weapon::BuildWeaponHits(const TArray<FHitResult>& FoundHits, FInventoryGameplayAbilityTargetData_WeaponHits& OutWeaponHits)
+{
+	for (int32 HitIndex = 0; HitIndex < FoundHits.Num(); ++HitIndex)
+	{
+		OutWeaponHits.AddHit(FoundHits[HitIndex], (uint8)FMath::Min(HitIndex, 255));
+	}
+}
+
 void UInventoryGameplayAbility_Weapon::StartWeaponTargeting()
 {
 	check(CurrentActorInfo);
 
-	AActor* AvatarActor = CurrentActorInfo->AvatarActor.Get();
-	check(AvatarActor);
-
 	UAbilitySystemComponent* MyAbilityComponent = CurrentActorInfo->AbilitySystemComponent.Get();
 	check(MyAbilityComponent);
 
@@ -156,19 +293,33 @@ void UInventoryGameplayAbility_Weapon::StartWeaponTargeting()
 	TArray<FHitResult> FoundHits;
 	PerformLocalTargeting(/*out*/ FoundHits);
 
+	SubmitWeaponHits(FoundHits);
+}
+
+void UInventoryGameplayAbility_Weapon::SubmitWeaponHits(const TArray<FHitResult>& FoundHits)
+{
+	check(CurrentActorInfo);
+
+	AActor* AvatarActor = CurrentActorInfo->AvatarActor.Get();
+	check(AvatarActor);
+
+	UAbilitySystemComponent* MyAbilityComponent = CurrentActorInfo->AbilitySystemComponent.Get();
+	check(MyAbilityComponent);
+
+	FScopedPredictionWindow ScopedPrediction(MyAbilityComponent, CurrentActivationInfo.GetActivationPredictionKey());
+
 	// Fill out the target data from the hit results
 	FGameplayAbilityTargetDataHandle TargetData;
 	TargetData.UniqueId = 0;
 
 	if (FoundHits.Num() > 0)
 	{
-		for (const FHitResult& FoundHit : FoundHits)
-		{
-			FGameplayAbilityTargetData_SingleTargetHit* NewTargetData = new FGameplayAbilityTargetData_SingleTargetHit();
-			NewTargetData->HitResult = FoundHit;
+		// one compact target data for the whole attack
+		FInventoryGameplayAbilityTargetData_WeaponHits* NewTargetData = new FInventoryGameplayAbilityTargetData_WeaponHits();
+		NewTargetData->Hits.Reserve(FoundHits.Num());
+		BuildWeaponHits(FoundHits, *NewTargetData);
 
-			TargetData.Add(NewTargetData);
-		}
+		TargetData.Add(NewTargetData);
 	}
 
 	// Process the target data immediately
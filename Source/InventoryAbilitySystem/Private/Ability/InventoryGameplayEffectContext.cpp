@@ -0,0 +1,67 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Ability/InventoryGameplayEffectContext.h"
+#include "Engine/NetSerialization.h"
+#include "PhysicalMaterials/PhysicalMaterial.h"
+
+void FInventoryGameplayEffectContext::AddDamageHit(const FHitResult& Hit)
+{
+	if (Hits.Num() == 0)
+		AddHitResult(Hit, /*bReset=*/ true);
+
+	FInventoryDamageHit& NewHit = Hits.AddDefaulted_GetRef();
+	NewHit.ImpactPoint = Hit.ImpactPoint;
+	NewHit.ImpactNormal = Hit.ImpactNormal;
+	NewHit.PhysMaterial = Hit.PhysMaterial;
+	NewHit.Distance = (float)FVector::Dist(Hit.TraceStart, Hit.ImpactPoint);
+}
+
+const FInventoryGameplayEffectContext* FInventoryGameplayEffectContext::ExtractEffectContext(const FGameplayEffectContextHandle& Handle)
+{
+	const FGameplayEffectContext* Context = Handle.Get();
+	if (Context && Context->GetScriptStruct()->IsChildOf(StaticStruct()))
+		return static_cast<const FInventoryGameplayEffectContext*>(Context);
+	return nullptr;
+}
+
+FGameplayEffectContext* FInventoryGameplayEffectContext::Duplicate() const
+{
+	FInventoryGameplayEffectContext* NewContext = new FInventoryGameplayEffectContext();
+	*NewContext = *this;
+	if (GetHitResult())
+	{
+		// Does a deep copy of the hit result
+		NewContext->AddHitResult(*GetHitResult(), /*bReset=*/ true);
+	}
+	return NewContext;
+}
+
+bool FInventoryGameplayEffectContext::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	FGameplayEffectContext::NetSerialize(Ar, Map, bOutSuccess);
+
+	uint32 NumHits = FMath::Min(Hits.Num(), MaxHits);
+	Ar.SerializeIntPacked(NumHits);
+	if (Ar.IsLoading())
+	{
+		if (NumHits > MaxHits)
+		{
+			Ar.SetError();
+			bOutSuccess = false;
+			return false;
+		}
+		Hits.SetNum(NumHits);
+	}
+
+	// cues only need the impacts roughly, the damage was already done on the server
+	for (uint32 HitIndex = 0; HitIndex < NumHits; ++HitIndex)
+	{
+		FInventoryDamageHit& Hit = Hits[HitIndex];
+		bOutSuccess &= SerializePackedVector<1, 24>(Hit.ImpactPoint, Ar);
+		bOutSuccess &= SerializeFixedVector<1, 8>(Hit.ImpactNormal, Ar);
+		Ar << Hit.PhysMaterial;
+	}
+
+	return true;
+}
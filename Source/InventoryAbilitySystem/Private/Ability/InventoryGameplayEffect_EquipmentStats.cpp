@@ -0,0 +1,41 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Ability/InventoryGameplayEffect_EquipmentStats.h"
+#include "Ability/Attribute/InventoryHealthSet.h"
+#include "InventoryAbilitySystem/InventoryGameplayTags.h"
+
+UInventoryGameplayEffect_EquipmentStats::UInventoryGameplayEffect_EquipmentStats(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	DurationPolicy = EGameplayEffectDurationType::Infinite;
+
+	AddStatModifier(UInventoryHealthSet::GetKineticArmorAttribute(), InventoryGameplayTags::Equipment_Stat_KineticArmor);
+	AddStatModifier(UInventoryHealthSet::GetEnergyArmorAttribute(), InventoryGameplayTags::Equipment_Stat_EnergyArmor);
+	AddStatModifier(UInventoryHealthSet::GetKineticResistanceAttribute(), InventoryGameplayTags::Equipment_Stat_KineticResistance);
+	AddStatModifier(UInventoryHealthSet::GetEnergyResistanceAttribute(), InventoryGameplayTags::Equipment_Stat_EnergyResistance);
+}
+
+void UInventoryGameplayEffect_EquipmentStats::GetStatTags(TArray<FGameplayTag>& OutStatTags) const
+{
+	for (const FGameplayModifierInfo& Modifier : Modifiers)
+	{
+		if (Modifier.ModifierMagnitude.GetMagnitudeCalculationType() == EGameplayEffectMagnitudeCalculation::SetByCaller)
+		{
+			const FGameplayTag StatTag = Modifier.ModifierMagnitude.GetSetByCallerFloat().DataTag;
+			if (StatTag.IsValid())
+				OutStatTags.AddUnique(StatTag);
+		}
+	}
+}
+
+void UInventoryGameplayEffect_EquipmentStats::AddStatModifier(const FGameplayAttribute& Attribute, FGameplayTag StatTag)
+{
+	FSetByCallerFloat SetByCaller;
+	SetByCaller.DataTag = StatTag;
+
+	FGameplayModifierInfo& Modifier = Modifiers.AddDefaulted_GetRef();
+	Modifier.Attribute = Attribute;
+	Modifier.ModifierOp = EGameplayModOp::Additive;
+	Modifier.ModifierMagnitude = FGameplayEffectModifierMagnitude(SetByCaller);
+}
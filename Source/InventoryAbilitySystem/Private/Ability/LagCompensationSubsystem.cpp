@@ -0,0 +1,264 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Ability/LagCompensationSubsystem.h"
+#include "Ability/InventoryAbilitySystemComponent.h"
+#include "Components/CapsuleComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+namespace LagCompensation
+{
+	static float RecordInterval = 1.0f / 60.0f;
+	static FAutoConsoleVariableRef CVarRecordInterval(
+		TEXT("LagCompensation.RecordInterval"),
+		RecordInterval,
+		TEXT("Minimum time between two recorded frames (in seconds), the history covers NumFrames of these"),
+		ECVF_Default);
+
+	static float MaxRewindTime = 0.4f;
+	static FAutoConsoleVariableRef CVarMaxRewindTime(
+		TEXT("LagCompensation.MaxRewindTime"),
+		MaxRewindTime,
+		TEXT("Hits of clients with a higher latency are checked against the poses of this long ago (in seconds)"),
+		ECVF_Default);
+
+	static float InterpolationDelay = 0.05f;
+	static FAutoConsoleVariableRef CVarInterpolationDelay(
+		TEXT("LagCompensation.InterpolationDelay"),
+		InterpolationDelay,
+		TEXT("Time clients display simulated pawns behind the latest update, added to the ping when rewinding (in seconds)"),
+		ECVF_Default);
+
+	static float HitTolerance = 40.0f;
+	static FAutoConsoleVariableRef CVarHitTolerance(
+		TEXT("LagCompensation.HitTolerance"),
+		HitTolerance,
+		TEXT("How far outside the historic capsule an impact may be, covers limbs and interpolation error (in uu)"),
+		ECVF_Default);
+
+	static float MaxOriginDistance = 250.0f;
+	static FAutoConsoleVariableRef CVarMaxOriginDistance(
+		TEXT("LagCompensation.MaxOriginDistance"),
+		MaxOriginDistance,
+		TEXT("How far from the shooter a trace may start (in uu)"),
+		ECVF_Default);
+
+	static bool bCheckOcclusion = true;
+	static FAutoConsoleVariableRef CVarCheckOcclusion(
+		TEXT("LagCompensation.CheckOcclusion"),
+		bCheckOcclusion,
+		TEXT("Traces static geometry between the trace start and hit pawns"),
+		ECVF_Default);
+}
+
+void ULagCompensationSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	// only the server registers pawns
+	if (Histories.Num() == 0)
+		return;
+
+	const double Time = GetWorld()->GetTimeSeconds();
+	if (NumRecordedFrames > 0 && Time - FrameTimes[NewestFrame] < LagCompensation::RecordInterval)
+		return;
+
+	NewestFrame = (NewestFrame + 1) % NumFrames;
+	NumRecordedFrames = FMath::Min(NumRecordedFrames + 1, NumFrames);
+	FrameTimes[NewestFrame] = Time;
+
+	for (int32 Index = Histories.Num() - 1; Index >= 0; --Index)
+	{
+		FPawnHistory& History = Histories[Index];
+		if (!History.Pawn.IsValid())
+		{
+			// destroyed without unregistering
+			HistoryIndex.Remove(History.Key);
+			Histories.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+			if (Histories.IsValidIndex(Index))
+				HistoryIndex.FindChecked(Histories[Index].Key) = Index;
+			continue;
+		}
+		History.Samples[NewestFrame] = SamplePawn(History);
+	}
+}
+
+TStatId ULagCompensationSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(ULagCompensationSubsystem, STATGROUP_Tickables);
+}
+
+FVector4f ULagCompensationSubsystem::SamplePawn(FPawnHistory& History) const
+{
+	if (const UCapsuleComponent* Capsule = History.Capsule.Get())
+	{
+		History.Radius = Capsule->GetScaledCapsuleRadius();
+		History.HalfHeight = Capsule->GetScaledCapsuleHalfHeight();
+	}
+	const FVector3f Center(History.Pawn->GetActorLocation());
+	return FVector4f(Center, History.HalfHeight);
+}
+
+void ULagCompensationSubsystem::RegisterPawn(APawn* Pawn)
+{
+	check(Pawn);
+
+	if (!Pawn->HasAuthority() || HistoryIndex.Contains(Pawn))
+		return;
+
+	const int32 Index = Histories.AddDefaulted();
+	HistoryIndex.Add(Pawn, Index);
+
+	FPawnHistory& History = Histories[Index];
+	History.Pawn = Pawn;
+	History.Key = Pawn;
+	History.Capsule = Cast<UCapsuleComponent>(Pawn->GetRootComponent());
+	Pawn->GetSimpleCollisionCylinder(History.Radius, History.HalfHeight);
+
+	// nothing is known about the past, pretend it always stood here
+	const FVector4f Sample = SamplePawn(History);
+	for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+	{
+		History.Samples[Frame] = Sample;
+	}
+}
+
+void ULagCompensationSubsystem::UnregisterPawn(APawn* Pawn)
+{
+	int32 Index = INDEX_NONE;
+	if (!HistoryIndex.RemoveAndCopyValue(Pawn, Index))
+		return;
+
+	Histories.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	if (Histories.IsValidIndex(Index))
+		HistoryIndex.FindChecked(Histories[Index].Key) = Index;
+}
+
+double ULagCompensationSubsystem::GetRewindTime(const AController* Shooter) const
+{
+	const double Time = GetWorld()->GetTimeSeconds();
+
+	const APlayerController* PC = Cast<APlayerController>(Shooter);
+	if (!PC || PC->IsLocalController() || !PC->PlayerState)
+		return Time;
+
+	// the client fired at what it saw half a round trip ago, and the shot took the other half to get here
+	const double Rewind = PC->PlayerState->GetPingInMilliseconds() * 0.001 + LagCompensation::InterpolationDelay;
+	return Time - FMath::Min(Rewind, (double)LagCompensation::MaxRewindTime);
+}
+
+bool ULagCompensationSubsystem::GetHistoricCapsule(const AActor* Actor, double Time, FVector& OutCenter, float& OutRadius, float& OutHalfHeight) const
+{
+	const int32* Index = HistoryIndex.Find(Actor);
+	if (!Index)
+		return false;
+
+	const FPawnHistory& History = Histories[*Index];
+	OutRadius = History.Radius;
+
+	// walk back from the newest frame to the first one at or before Time, and blend towards the one after it
+	FVector4f Sample = History.Samples[NewestFrame];
+	int32 Newer = NewestFrame;
+	for (int32 Age = 0; Age < NumRecordedFrames; ++Age)
+	{
+		const int32 Frame = (NewestFrame - Age + NumFrames) % NumFrames;
+		if (FrameTimes[Frame] <= Time)
+		{
+			Sample = History.Samples[Frame];
+			if (Frame != Newer)
+			{
+				const float Alpha = (float)((Time - FrameTimes[Frame]) / FMath::Max(FrameTimes[Newer] - FrameTimes[Frame], UE_SMALL_NUMBER));
+				Sample = FMath::Lerp(Sample, History.Samples[Newer], Alpha);
+			}
+			break;
+		}
+		// older than the history, the oldest frame is the best we have
+		Sample = History.Samples[Frame];
+		Newer = Frame;
+	}
+
+	OutCenter = FVector(Sample.X, Sample.Y, Sample.Z);
+	OutHalfHeight = Sample.W;
+	return true;
+}
+
+bool ULagCompensationSubsystem::IsValidOrigin(const FVector& TraceStart, const AActor* Shooter, double Time) const
+{
+	if (!Shooter)
+		return true;
+
+	// the shooter has moved on since it fired, the trace starts where it was at the rewind time
+	FVector Origin;
+	float Radius, HalfHeight;
+	if (!GetHistoricCapsule(Shooter, Time, Origin, Radius, HalfHeight))
+		Origin = Shooter->GetActorLocation();
+	return FVector::DistSquared(TraceStart, Origin) <= FMath::Square(LagCompensation::MaxOriginDistance);
+}
+
+ELagCompensatedHit ULagCompensationSubsystem::ValidateHit(const FHitResult& Hit, const AActor* Shooter, double Time, float MaxRange) const
+{
+	using namespace LagCompensation;
+
+	ELagCompensatedHit Result = ELagCompensatedHit::Valid;
+
+	const FVector ToImpact = Hit.ImpactPoint - Hit.TraceStart;
+	const double Length = ToImpact.Size();
+
+	if (!IsValidOrigin(Hit.TraceStart, Shooter, Time))
+	{
+		Result = ELagCompensatedHit::InvalidOrigin;
+	}
+	else if (MaxRange > 0.0f && Length > MaxRange + HitTolerance)
+	{
+		Result = ELagCompensatedHit::OutOfReach;
+	}
+	else
+	{
+		// actors that aren't recorded are trusted to be where the client hit them, the occlusion trace stops short of the impact
+		float Clearance = HitTolerance;
+		FVector Center;
+		float Radius, HalfHeight;
+		if (GetHistoricCapsule(Hit.GetActor(), Time, Center, Radius, HalfHeight))
+		{
+			const FVector Axis(0.0f, 0.0f, FMath::Max(HalfHeight - Radius, 0.0f));
+			const FVector Closest = FMath::ClosestPointOnSegment(Hit.ImpactPoint, Center - Axis, Center + Axis);
+			if (FVector::DistSquared(Hit.ImpactPoint, Closest) > FMath::Square(Radius + HitTolerance))
+				Result = ELagCompensatedHit::OutOfReach;
+			Clearance += Radius;
+		}
+
+		if (Result == ELagCompensatedHit::Valid && bCheckOcclusion && Length > Clearance)
+		{
+			// bounded to the segment in front of the target, only static geometry can block it
+			const FVector TraceEnd = Hit.TraceStart + ToImpact * ((Length - Clearance) / Length);
+			FCollisionQueryParams Params(SCENE_QUERY_STAT(LagCompensationOcclusion), /*bTraceComplex=*/ false, Shooter);
+			Params.AddIgnoredActor(Hit.GetActor());
+			if (GetWorld()->LineTraceTestByObjectType(Hit.TraceStart, TraceEnd, FCollisionObjectQueryParams(ECC_WorldStatic), Params))
+				Result = ELagCompensatedHit::Occluded;
+		}
+	}
+
+	if (Result == ELagCompensatedHit::Valid)
+		NumHitsValidated++;
+	else
+		NumHitsRejected++;
+	return Result;
+}
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommandWithWorld DumpLagCompensationStatsCommand(
+	TEXT("LagCompensation.Stats"),
+	TEXT("Logs the recorded pawns, the history memory and how many client hits were accepted or rejected"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+		{
+			if (const ULagCompensationSubsystem* Subsystem = UWorld::GetSubsystem<ULagCompensationSubsystem>(World))
+			{
+				UE_LOG(LogInventoryAbilitySystem, Display, TEXT("Lag compensation: %d pawns, %d bytes of history, %d hits validated, %d hits rejected"),
+					Subsystem->GetNumPawns(), Subsystem->GetNumPawns() * ULagCompensationSubsystem::NumFrames * (int32)sizeof(FVector4f),
+					Subsystem->NumHitsValidated, Subsystem->NumHitsRejected);
+			}
+		}));
+#endif
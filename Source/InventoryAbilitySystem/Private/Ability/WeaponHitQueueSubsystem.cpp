@@ -0,0 +1,137 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Ability/WeaponHitQueueSubsystem.h"
+#include "Ability/InventoryAbilitySystemComponent.h"
+#include "Ability/InventoryGameplayEffectContext.h"
+#include "Equipment/WeaponInstance.h"
+#include "AbilitySystemGlobals.h"
+#include "GameplayEffect.h"
+#include "HAL/IConsoleManager.h"
+
+namespace WeaponHitQueue
+{
+	// the spec of a group is made with the level and ability of its first hit, so hits only share an effect if those match too
+	struct FGroupKey
+	{
+		TObjectKey<UAbilitySystemComponent> Source;
+		TObjectKey<UAbilitySystemComponent> Target;
+		TObjectKey<UWeaponInstance> Weapon;
+		TObjectKey<UClass> DamageEffect;
+		TObjectKey<UGameplayAbility> Ability;
+		float Level = 1.0f;
+
+		bool operator==(const FGroupKey& Other) const
+		{
+			return Source == Other.Source && Target == Other.Target && Weapon == Other.Weapon && DamageEffect == Other.DamageEffect
+				&& Ability == Other.Ability && Level == Other.Level;
+		}
+
+		friend uint32 GetTypeHash(const FGroupKey& Key)
+		{
+			const uint32 Hash = HashCombine(HashCombine(GetTypeHash(Key.Source), GetTypeHash(Key.Target)), HashCombine(GetTypeHash(Key.Weapon), GetTypeHash(Key.DamageEffect)));
+			return HashCombine(Hash, HashCombine(GetTypeHash(Key.Ability), GetTypeHash(Key.Level)));
+		}
+	};
+}
+
+void UWeaponHitQueueSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	Flush();
+}
+
+TStatId UWeaponHitQueueSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UWeaponHitQueueSubsystem, STATGROUP_Tickables);
+}
+
+void UWeaponHitQueueSubsystem::QueueHit(UAbilitySystemComponent* Source, const UGameplayAbility* Ability, UWeaponInstance* Weapon, TSubclassOf<UGameplayEffect> DamageEffect, float Level, const FHitResult& Hit)
+{
+	if (!Source || !DamageEffect || !Source->IsOwnerActorAuthoritative())
+		return;
+
+	UAbilitySystemComponent* Target = UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(Hit.GetActor());
+	if (!Target)
+		return;
+
+	FQueuedHit& QueuedHit = QueuedHits.AddDefaulted_GetRef();
+	QueuedHit.Source = Source;
+	QueuedHit.Target = Target;
+	QueuedHit.Ability = Ability;
+	QueuedHit.Weapon = Weapon;
+	QueuedHit.DamageEffect = DamageEffect;
+	QueuedHit.Level = Level;
+	QueuedHit.Hit = Hit;
+}
+
+void UWeaponHitQueueSubsystem::Flush()
+{
+	if (QueuedHits.Num() == 0)
+		return;
+
+	// applying an effect can kill a target and queue more hits, those wait for the next flush
+	TArray<FQueuedHit> Hits = MoveTemp(QueuedHits);
+	QueuedHits.Reset();
+
+	// the first hit of a group holds its context, the others are added to it
+	TMap<WeaponHitQueue::FGroupKey, int32> GroupIndices;
+	TArray<FGameplayEffectContextHandle> GroupContexts;
+	TArray<int32> GroupFirstHits;
+	for (int32 HitIndex = 0; HitIndex < Hits.Num(); ++HitIndex)
+	{
+		const FQueuedHit& Hit = Hits[HitIndex];
+		UAbilitySystemComponent* Source = Hit.Source.Get();
+		if (!Source || !Hit.Target.IsValid())
+			continue;
+
+		const WeaponHitQueue::FGroupKey Key{ Hit.Source.Get(), Hit.Target.Get(), Hit.Weapon.Get(), Hit.DamageEffect.Get(), Hit.Ability.Get(), Hit.Level };
+		int32& GroupIndex = GroupIndices.FindOrAdd(Key, INDEX_NONE);
+		if (GroupIndex == INDEX_NONE)
+		{
+			// what UAbilitySystemComponent::MakeEffectContext fills in, with the hits on top
+			FInventoryGameplayEffectContext* Context = new FInventoryGameplayEffectContext(Source->GetOwnerActor(), Source->GetAvatarActor_Direct());
+			Context->SetAbility(Hit.Ability.Get());
+			Context->AddSourceObject(Hit.Weapon.Get());
+			Context->AddOrigin(Hit.Hit.TraceStart);
+
+			GroupIndex = GroupContexts.Add(FGameplayEffectContextHandle(Context));
+			GroupFirstHits.Add(HitIndex);
+		}
+
+		// every hit deals its damage, only the impacts sent to the cues are capped
+		static_cast<FInventoryGameplayEffectContext*>(GroupContexts[GroupIndex].Get())->AddDamageHit(Hit.Hit);
+	}
+
+	for (int32 GroupIndex = 0; GroupIndex < GroupContexts.Num(); ++GroupIndex)
+	{
+		const FQueuedHit& FirstHit = Hits[GroupFirstHits[GroupIndex]];
+		UAbilitySystemComponent* Source = FirstHit.Source.Get();
+		UAbilitySystemComponent* Target = FirstHit.Target.Get();
+		if (!Source || !Target)
+			continue;
+
+		const FGameplayEffectSpecHandle Spec = Source->MakeOutgoingSpec(FirstHit.DamageEffect, FirstHit.Level, GroupContexts[GroupIndex]);
+		if (!Spec.IsValid())
+			continue;
+
+		Source->ApplyGameplayEffectSpecToTarget(*Spec.Data.Get(), Target);
+		NumHitsApplied += static_cast<const FInventoryGameplayEffectContext*>(GroupContexts[GroupIndex].Get())->Hits.Num();
+		NumEffectsApplied++;
+	}
+}
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommandWithWorld DumpWeaponHitQueueStatsCommand(
+	TEXT("Inventory.Weapon.HitQueueStats"),
+	TEXT("Logs how many weapon hits the server applied and in how many damage effects"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+		{
+			if (const UWeaponHitQueueSubsystem* Subsystem = UWorld::GetSubsystem<UWeaponHitQueueSubsystem>(World))
+			{
+				UE_LOG(LogInventoryAbilitySystem, Display, TEXT("Weapon hit queue: %d hits applied in %d effects, %d queued"),
+					Subsystem->NumHitsApplied, Subsystem->NumEffectsApplied, Subsystem->GetNumQueuedHits());
+			}
+		}));
+#endif
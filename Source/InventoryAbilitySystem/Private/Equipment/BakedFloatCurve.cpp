@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Equipment/BakedFloatCurve.h"
+#include "Ability/InventoryAbilitySystemComponent.h"
+#include "Curves/RichCurve.h"
+
+namespace BakedFloatCurve
+{
+	// Sample count the doubling starts from
+	static const int32 MinSamples = 8;
+
+	// Number of points between two samples the error is measured at
+	static const int32 ErrorProbesPerSegment = 3;
+}
+
+void FBakedFloatCurve::Bake(const FRichCurve& Curve, int32 MaxSamples, float MaxError)
+{
+	using namespace BakedFloatCurve;
+
+	Reset();
+
+	Curve.GetTimeRange(/*out*/ MinTime, /*out*/ MaxTime);
+	Curve.GetValueRange(/*out*/ MinValue, /*out*/ MaxValue);
+
+	// Empty and single key curves are a single value
+	if (Curve.GetNumKeys() < 2 || MaxTime <= MinTime)
+	{
+		Samples.Add(Curve.Eval(MinTime));
+		return;
+	}
+
+	MaxSamples = FMath::Max(MaxSamples, 2);
+	MaxError = FMath::Max(MaxError, 0.0f);
+
+	for (int32 NumSamples = FMath::Min(MinSamples, MaxSamples); ; NumSamples = FMath::Min(NumSamples * 2, MaxSamples))
+	{
+		const float Step = (MaxTime - MinTime) / (NumSamples - 1);
+
+		Samples.SetNumUninitialized(NumSamples);
+		for (int32 Index = 0; Index < NumSamples; ++Index)
+		{
+			Samples[Index] = Curve.Eval(MinTime + Index * Step);
+		}
+		InvStep = 1.0f / Step;
+		LastSample = (float)(NumSamples - 1);
+
+		BakedError = 0.0f;
+		for (int32 Index = 0; Index < NumSamples - 1; ++Index)
+		{
+			for (int32 Probe = 1; Probe <= ErrorProbesPerSegment; ++Probe)
+			{
+				const float Time = MinTime + (Index + (float)Probe / (ErrorProbesPerSegment + 1)) * Step;
+				BakedError = FMath::Max(BakedError, FMath::Abs(Eval(Time) - Curve.Eval(Time)));
+			}
+		}
+
+		if (BakedError <= MaxError || NumSamples >= MaxSamples)
+		{
+			break;
+		}
+	}
+
+	if (BakedError > MaxError)
+	{
+		UE_LOG(LogInventoryAbilitySystem, Verbose, TEXT("Baked curve error %f is above %f with %d samples"), BakedError, MaxError, Samples.Num());
+	}
+}
+
+void FBakedFloatCurve::Reset()
+{
+	Samples.Reset();
+	MinTime = 0.0f;
+	MaxTime = 0.0f;
+	InvStep = 0.0f;
+	LastSample = 0.0f;
+	MinValue = 0.0f;
+	MaxValue = 0.0f;
+	BakedError = 0.0f;
+}
@@ -6,7 +6,16 @@
 #include "Inventory/InventoryItemInstance.h"
 #include "Inventory/InventoryComponent.h"
 #include "Ability/InventoryAbilitySystemComponent.h"
+#include "Ability/InventoryGameplayEffect_EquipmentStats.h"
+#include "Ability/InventoryGameplayAbility_RangedWeapon.h"
+#include "Equipment/ProjectileSubsystem.h"
 #include "AbilitySystemGlobals.h"
+#include "Engine/ActorChannel.h"
+#include "GameFramework/Pawn.h"
+#include "Net/UnrealNetwork.h"
+#include "TimerManager.h"
+#include "Engine/AssetManager.h"
+#include "Engine/StreamableManager.h"
 
 UEquipmentDefinition::UEquipmentDefinition(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
@@ -14,394 +23,1499 @@ UEquipmentDefinition::UEquipmentDefinition(const FObjectInitializer& ObjectIniti
 	InstanceType = UEquipmentInstance::StaticClass();
 }
 
-UEquipmentComponent::UEquipmentComponent(const FObjectInitializer& ObjectInitializer)
-	:Super(ObjectInitializer)
-{
-	bWantsInitializeComponent = true;
-}
-
-void UEquipmentComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+void UEquipmentDefinition::GatherAssetsToLoad(TArray<FSoftObjectPath>& OutAssets) const
 {
-	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+	// dedicated servers that strip cosmetics never spawn the visual actors
+	const bool bSkipCosmeticActors = !UEquipmentInstance::ShouldRunCosmetics(nullptr);
 
-	for (FAppliedEquipmentEntry& entry : equipmentList) {
-		if (UEquipmentInstance* instance = entry.instance) {
-			instance->Tick(DeltaTime);
-		}
+	for (const FEquipmentActorToSpawn& SpawnInfo : ActorsToSpawn)
+	{
+		if (!SpawnInfo.bGameplayRelevant && bSkipCosmeticActors)
+			continue;
+		if (!SpawnInfo.ActorToSpawn.IsNull())
+			OutAssets.AddUnique(SpawnInfo.ActorToSpawn.ToSoftObjectPath());
 	}
+
+	if (InstanceType)
+		InstanceType->GetDefaultObject<UEquipmentInstance>()->GatherAssetsToLoad(OutAssets);
 }
 
-void UEquipmentComponent::UninitializeComponent()
+UInventoryAbilitySystemComponent* FEquipmentList::GetAbilitySystemComponent() const
 {
-	UnequipEverything();
-
-	Super::UninitializeComponent();
+	check(ownerComponent);
+	return Cast<UInventoryAbilitySystemComponent>(UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(ownerComponent->GetOwner()));
 }
 
-UEquipmentInstance* UEquipmentComponent::EquipItemDefinition(TSubclassOf<UEquipmentDefinition> EquipmentDefinition)
+UEquipmentInstance* FEquipmentList::AddEntry(TSubclassOf<UEquipmentDefinition> EquipmentDefinition, bool bDormant)
 {
-	UEquipmentInstance* Result = nullptr;
-	if (EquipmentDefinition)
-	{
-		const UEquipmentDefinition* EquipmentCDO = GetDefault<UEquipmentDefinition>(EquipmentDefinition);
+	check(EquipmentDefinition != nullptr);
+	check(ownerComponent);
+	check(ownerComponent->GetOwner()->HasAuthority());
 
-		TSubclassOf<UEquipmentInstance> InstanceType = EquipmentCDO->InstanceType;
-		if (InstanceType == nullptr)
-		{
-			InstanceType = UEquipmentInstance::StaticClass();
-		}
+	const UEquipmentDefinition* EquipmentCDO = GetDefault<UEquipmentDefinition>(EquipmentDefinition);
+
+	TSubclassOf<UEquipmentInstance> InstanceType = EquipmentCDO->InstanceType;
+	if (InstanceType == nullptr)
+	{
+		InstanceType = UEquipmentInstance::StaticClass();
+	}
 
-		FAppliedEquipmentEntry& NewEntry = equipmentList.AddDefaulted_GetRef();
-		NewEntry.equipmentDefinition = EquipmentDefinition;
-		NewEntry.instance = NewObject<UEquipmentInstance>(GetOwner(), InstanceType);
-		Result = NewEntry.instance;
+	FAppliedEquipmentEntry& NewEntry = Entries.AddDefaulted_GetRef();
+	NewEntry.equipmentDefinition = EquipmentDefinition;
+	NewEntry.bDormant = bDormant;
+	NewEntry.instance = NewObject<UEquipmentInstance>(ownerComponent->GetOwner(), InstanceType);
+	UEquipmentInstance* Result = NewEntry.instance;
+	Result->SetEquipmentDefinition(EquipmentDefinition);
 
-		if (UInventoryAbilitySystemComponent* component = GetAbilitySystemComponent())
+	if (UInventoryAbilitySystemComponent* component = GetAbilitySystemComponent())
+	{
+		for (TObjectPtr<const UAbilitySet> AbilitySet : EquipmentCDO->AbilitySetsToGrant)
 		{
-			for (TObjectPtr<const UAbilitySet> AbilitySet : EquipmentCDO->AbilitySetsToGrant)
-			{
-				AbilitySet->GiveToAbilitySystem(component, /*inout*/ &NewEntry.grantedHandles, Result);
-			}
+			AbilitySet->GiveToAbilitySystem(component, /*inout*/ &NewEntry.grantedHandles, Result);
 		}
+	}
 
+	// a batch spawns the actors of all its entries in one pass, see UEquipmentComponent::EndEquipBatch
+	if (!ownerComponent->bBatchingEquips)
+	{
 		Result->SpawnEquipmentActors(EquipmentCDO->ActorsToSpawn);
-
-		if (Result != nullptr)
-		{
-			Result->OnEquipped();
-
-			if (IsUsingRegisteredSubObjectList() && IsReadyForReplication())
-			{
-				AddReplicatedSubObject(Result);
-			}
-		}
+	}
+	if (bDormant)
+	{
+		Result->SetDormant(true);
 	}
 
-	OnEquip.Broadcast(Result);
+	UpdateIndex(NewEntry);
+	MarkItemDirty(NewEntry);
+
 	return Result;
 }
 
-void UEquipmentComponent::EquipItemInstance(int32 slotId, UInventoryItemInstance* instance)
+void FEquipmentList::RemoveEntry(UEquipmentInstance* Instance)
 {
-	if (instance) {
-		if (const UInventoryFragment_EquippableItem* EquipInfo = instance->FindFragmentByClass<UInventoryFragment_EquippableItem>())
+	for (auto EntryIt = Entries.CreateIterator(); EntryIt; ++EntryIt)
+	{
+		FAppliedEquipmentEntry& Entry = *EntryIt;
+		if (Entry.instance == Instance)
 		{
-			TObjectPtr<UEquipmentInstance> NewEquipment;
-			TSubclassOf<UEquipmentDefinition> EquipDef = EquipInfo->EquipmentDefinition;
-			if (EquipDef != nullptr)
-			{
-				NewEquipment = EquipItemDefinition(EquipDef);
-				if (NewEquipment)
-				{
-					NewEquipment->SetInstigator(instance);
-				}
-			}
-
-			int32 categoryId = INDEX_NONE;
-			if (!equipmentCategories.Find(EquipInfo->GetClass(), categoryId))
+			if (UInventoryAbilitySystemComponent* component = GetAbilitySystemComponent())
 			{
-				categoryId = equipmentCategories.Emplace(EquipInfo->GetClass());
+				Entry.grantedHandles.TakeFromAbilitySystem(component);
 			}
 
-			TArray<TObjectPtr<UInventoryItemInstance>> categoryItems;
-			TArray<TObjectPtr<UEquipmentInstance>> categoryEquipment;
-			if (equipmentSlots.IsValidIndex(categoryId))
-			{
-				categoryItems = equipmentSlots[categoryId];
-				categoryEquipment = equippedItems[categoryId];
-
-				if (categoryItems.IsValidIndex(slotId))
-				{
-					categoryItems[slotId] = instance;
-					categoryEquipment[slotId] = NewEquipment;
-				}
-				else
-				{
-					categoryItems.EmplaceAt(slotId, instance);
-					categoryEquipment.EmplaceAt(slotId, NewEquipment);
-				}
+			Instance->DestroyEquipmentActors();
 
-				equipmentSlots[categoryId] = categoryItems;
-				equippedItems[categoryId] = categoryEquipment;
-			}
-			else
-			{
-				categoryItems.EmplaceAt(slotId, instance);
-				equipmentSlots.Emplace(categoryItems);
-				categoryEquipment.EmplaceAt(slotId, NewEquipment);
-				equippedItems.Emplace(categoryEquipment);
-			}
+			RemoveFromIndex(Entry);
+			EntryIt.RemoveCurrent();
+			MarkArrayDirty();
 		}
-		return;
 	}
 }
 
-UInventoryItemInstance* UEquipmentComponent::RemoveItemInstance(int32 slotId, TSubclassOf<UInventoryFragment_EquippableItem> type)
+void FEquipmentList::SetEntryDormant(UEquipmentInstance* Instance, bool bDormant)
 {
-	UInventoryItemInstance* Result = nullptr;
-	int32 categoryId = INDEX_NONE;
-	if (equipmentCategories.Find(type, categoryId))
+	for (FAppliedEquipmentEntry& Entry : Entries)
 	{
-		if (TArray<TObjectPtr<UInventoryItemInstance>>* slots = &equipmentSlots[categoryId])
+		if (Entry.instance == Instance && Entry.bDormant != bDormant)
 		{
-			if (slots->IsValidIndex(slotId))
-			{
-				Result = (*slots)[slotId];
-				if (Result)
-				{
-					UnequipItem(equippedItems[categoryId][slotId]);
-					(*slots)[slotId] = nullptr;
-				}
-			}
+			Entry.bDormant = bDormant;
+			MarkItemDirty(Entry);
 		}
 	}
-	return Result;
 }
 
-void UEquipmentComponent::UnequipItem(UEquipmentInstance* ItemInstance)
+void FEquipmentList::PredictEntryDormant(UEquipmentInstance* Instance, bool bDormant)
 {
-	if (ItemInstance)
+	for (FAppliedEquipmentEntry& Entry : Entries)
 	{
-		if (IsUsingRegisteredSubObjectList())
+		if (Entry.instance == Instance)
 		{
-			RemoveReplicatedSubObject(ItemInstance);
+			EquipLocally(Entry, bDormant);
 		}
+	}
+}
 
-		ItemInstance->OnUnequipped();
-		OnUnequip.Broadcast(ItemInstance);
+void FEquipmentList::ReconcileLocally()
+{
+	for (FAppliedEquipmentEntry& Entry : Entries)
+	{
+		EquipLocally(Entry);
+	}
+}
 
-		for (auto EntryIt = equipmentList.CreateIterator(); EntryIt; ++EntryIt)
+void FEquipmentList::PreReplicatedRemove(const TArrayView<int32> RemovedIndices, int32 FinalSize)
+{
+	for (int32 Index : RemovedIndices)
+	{
+		FAppliedEquipmentEntry& Entry = Entries[Index];
+		RemoveFromIndex(Entry);
+		if (Entry.bEquippedLocally && Entry.instance != nullptr)
 		{
-			FAppliedEquipmentEntry& Entry = *EntryIt;
-			if (Entry.instance == ItemInstance)
-			{
-				if (UInventoryAbilitySystemComponent* component = GetAbilitySystemComponent())
-				{
-					Entry.grantedHandles.TakeFromAbilitySystem(component);
-				}
-
-				ItemInstance->DestroyEquipmentActors();
-
-
-				EntryIt.RemoveCurrent();
-			}
+			Entry.bEquippedLocally = false;
+			Entry.instance->OnUnequipped();
+			ownerComponent->OnUnequip.Broadcast(Entry.instance);
 		}
 	}
 }
 
-void UEquipmentComponent::UnequipEverything()
+void FEquipmentList::PostReplicatedAdd(const TArrayView<int32> AddedIndices, int32 FinalSize)
 {
-	TArray<UEquipmentInstance*> AllEquipmentInstances;
+	for (int32 Index : AddedIndices)
+	{
+		// clients play the montages and link the layers, they stream the assets in like the server does
+		ownerComponent->PreloadEquipment(Entries[Index].equipmentDefinition);
 
-	// gathering all instances before removal to avoid side effects affecting the equipment list iterator	
-	for (const FAppliedEquipmentEntry& Entry : equipmentList)
+		UpdateIndex(Entries[Index]);
+		EquipLocally(Entries[Index]);
+	}
+}
+
+void FEquipmentList::PostReplicatedChange(const TArrayView<int32> ChangedIndices, int32 FinalSize)
+{
+	// the instance reference may only resolve after the entry itself arrived, dormant changes toggle it
+	for (int32 Index : ChangedIndices)
 	{
-		AllEquipmentInstances.Add(Entry.instance);
+		UpdateIndex(Entries[Index]);
+		EquipLocally(Entries[Index]);
 	}
+}
 
-	for (UEquipmentInstance* EquipInstance : AllEquipmentInstances)
+void FEquipmentList::EquipLocally(FAppliedEquipmentEntry& Entry)
+{
+	// a predicted weapon switch owns the weapon entries until the server acknowledged it
+	if (Entry.instance != nullptr && ownerComponent->IsPredictingWeaponSwitch() && ownerComponent->weaponInstances.Contains(Entry.instance))
 	{
-		UnequipItem(EquipInstance);
+		return;
 	}
+
+	EquipLocally(Entry, Entry.bDormant);
 }
 
-UEquipmentInstance* UEquipmentComponent::GetFirstInstanceOfType(TSubclassOf<UEquipmentInstance> InstanceType)
+void FEquipmentList::EquipLocally(FAppliedEquipmentEntry& Entry, bool bDormant)
 {
-	for (FAppliedEquipmentEntry& Entry : equipmentList)
+	if (Entry.instance == nullptr)
+	{
+		return;
+	}
+
+	Entry.instance->SetDormant(bDormant);
+
+	const bool bShouldBeEquipped = !bDormant;
+
+	// the equip waits for its preload like a weapon swap on the server, OnPreloadCompleted reconciles the entry
+	if (bShouldBeEquipped && !Entry.bEquippedLocally && ownerComponent->bDeferEquipUntilLoaded && ownerComponent->IsPreloadInProgress(Entry.equipmentDefinition))
+	{
+		FEquipmentPreloadStats::Get().NumEquipsDeferred++;
+		return;
+	}
+
+	if (Entry.bEquippedLocally != bShouldBeEquipped)
 	{
-		if (UEquipmentInstance* Instance = Entry.instance)
+		Entry.bEquippedLocally = bShouldBeEquipped;
+		if (bShouldBeEquipped)
 		{
-			if (Instance->IsA(InstanceType))
-			{
-				return Instance;
-			}
+			Entry.instance->OnEquipped();
+			ownerComponent->OnEquip.Broadcast(Entry.instance);
+		}
+		else
+		{
+			Entry.instance->OnUnequipped();
+			ownerComponent->OnUnequip.Broadcast(Entry.instance);
 		}
 	}
-	return nullptr;
 }
 
-TArray<UEquipmentInstance*> UEquipmentComponent::GetEquipmentInstancesOfType(TSubclassOf<UEquipmentInstance> InstanceType) const
+void FEquipmentList::UpdateIndex(FAppliedEquipmentEntry& Entry)
 {
-	TArray<UEquipmentInstance*> Results;
-	for (const FAppliedEquipmentEntry& Entry : equipmentList)
+	if (Entry.indexedInstance == Entry.instance)
+	{
+		return;
+	}
+
+	RemoveFromIndex(Entry);
+
+	if (UEquipmentInstance* Instance = Entry.instance)
 	{
-		if (UEquipmentInstance* Instance = Entry.instance)
+		for (const UClass* Class = Instance->GetClass(); Class; Class = Class->GetSuperClass())
 		{
-			if (Instance->IsA(InstanceType))
+			instancesByClass.FindOrAdd(Class).Add(Instance);
+			if (Class == UEquipmentInstance::StaticClass())
 			{
-				Results.Add(Instance);
+				break;
 			}
 		}
+		Entry.indexedInstance = Instance;
 	}
-	return Results;
 }
 
-TArray<UInventoryItemInstance*> UEquipmentComponent::GetSlots(TSubclassOf<UInventoryFragment_EquippableItem> type) const
+void FEquipmentList::RemoveFromIndex(FAppliedEquipmentEntry& Entry)
 {
-	if (type->IsChildOf(UInventoryFragment_WeaponItem::StaticClass()))
-		return weaponSlots;
-	else
+	if (UEquipmentInstance* Instance = Entry.indexedInstance)
 	{
-		TArray<UInventoryItemInstance*> Results;
-		int32 categoryId = INDEX_NONE;
-		if (equipmentCategories.Find(type, categoryId))
+		for (const UClass* Class = Instance->GetClass(); Class; Class = Class->GetSuperClass())
 		{
-			if (const TArray<TObjectPtr<UInventoryItemInstance>>* slots = &equipmentSlots[categoryId])
+			if (TArray<UEquipmentInstance*>* Instances = instancesByClass.Find(Class))
+			{
+				// keeps the equip order for GetFirstInstanceOfType
+				Instances->RemoveSingle(Instance);
+			}
+			if (Class == UEquipmentInstance::StaticClass())
 			{
-				Results = *slots;
+				break;
 			}
 		}
-		return Results;
+		Entry.indexedInstance = nullptr;
 	}
 }
 
-int32 UEquipmentComponent::GetNextFreeWeaponSlot()
+UEquipmentComponent::UEquipmentComponent(const FObjectInitializer& ObjectInitializer)
+	:Super(ObjectInitializer)
+	, equipmentList(this)
 {
-	int32 SlotIndex = 0;
-	for (TObjectPtr<UInventoryItemInstance> ItemPtr : weaponSlots)
-	{
-		if (ItemPtr == nullptr)
-		{
-			return SlotIndex;
-		}
-		++SlotIndex;
-	}
+	SetIsReplicatedByDefault(true);
+	bWantsInitializeComponent = true;
 
-	return INDEX_NONE;
+	// equipment instances are ticked by the UEquipmentTickSubsystem
+	PrimaryComponentTick.bCanEverTick = false;
+
+	equipmentStatEffect = UInventoryGameplayEffect_EquipmentStats::StaticClass();
 }
 
-void UEquipmentComponent::AddItemToSlot(int32 slotId, UInventoryItemInstance* item)
+void UEquipmentComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
-	if (const UInventoryFragment_EquippableItem* EquipInfo = item->FindFragmentByClass<UInventoryFragment_EquippableItem>())
-	{
-		if (EquipInfo->IsA(UInventoryFragment_WeaponItem::StaticClass()))
-		{
-			if (weaponSlots.Num() < numWeaponSlots)
-				weaponSlots.AddDefaulted(numWeaponSlots - weaponSlots.Num());
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-			if (weaponSlots.IsValidIndex(slotId) && item)
-				weaponSlots[slotId] = item;
-		}
-		else
-			EquipItemInstance(slotId, item);
-	}
+	DOREPLIFETIME(ThisClass, equipmentList);
+	DOREPLIFETIME(ThisClass, replicatedWeaponSlot);
+	DOREPLIFETIME_CONDITION(ThisClass, occupiedWeaponSlots, COND_OwnerOnly);
+	DOREPLIFETIME_CONDITION(ThisClass, weaponInstances, COND_OwnerOnly);
 }
 
-UInventoryItemInstance* UEquipmentComponent::RemoveItemFromSlot(int32 slotId, TSubclassOf<UInventoryFragment_EquippableItem> type)
+void UEquipmentComponent::InitializeComponent()
 {
-	UInventoryItemInstance* Result = nullptr;
+	Super::InitializeComponent();
 
-	if (type->IsChildOf(UInventoryFragment_WeaponItem::StaticClass()))
+	// size the slot table up front so equipping never has to grow it
+	for (const FEquipmentCategoryConfig& config : equipmentCategoryConfig)
 	{
-		if (activeSlotIndex == slotId)
+		if (config.Category && FindCategoryId(config.Category) == INDEX_NONE)
 		{
-			UnequipWeaponInSlot();
-			activeSlotIndex = -1;
+			categoryIds.Add(config.Category, AddCategory(config.Category, config.NumSlots));
 		}
+	}
+}
 
-		if (weaponSlots.IsValidIndex(slotId))
-		{
-			Result = weaponSlots[slotId];
+void UEquipmentComponent::UninitializeComponent()
+{
+	UnequipEverything();
+	DestroyActorPools();
 
-			if (Result != nullptr)
-			{
-				weaponSlots[slotId] = nullptr;
-			}
-		}
+	if (equipmentStatHandle.IsValid())
+	{
+		if (UInventoryAbilitySystemComponent* ASC = GetAbilitySystemComponent())
+			ASC->RemoveActiveGameplayEffect(equipmentStatHandle);
+		equipmentStatHandle.Invalidate();
+		equipmentStatMagnitudes.Reset();
 	}
-	else
+
+	for (TPair<TSubclassOf<UEquipmentDefinition>, TSharedPtr<FStreamableHandle>>& pair : preloadHandles)
 	{
-		Result = RemoveItemInstance(slotId, type);
+		if (pair.Value.IsValid())
+			pair.Value->CancelHandle();
 	}
+	preloadHandles.Empty();
+	residentDefinitions.Empty();
+	bLoadoutPending = false;
+	pendingLoadoutSlots.Reset();
+	pendingLoadoutItems.Reset();
 
-	return Result;
+	Super::UninitializeComponent();
 }
 
-void UEquipmentComponent::SetActiveSlotIndex(int32 newId)
+void UEquipmentComponent::BeginPlay()
 {
-	if (weaponSlots.IsValidIndex(newId) && (activeSlotIndex != newId)) {
-		UnequipWeaponInSlot();
-
-		activeSlotIndex = newId;
+	Super::BeginPlay();
 
-		EquipWeaponInSlot();
+	if (GetOwner()->HasAuthority())
+	{
+		WarmupActorPools();
 
-		OnWeaponSlotChanged.Broadcast(activeSlotIndex);
+		if (pooledActorIdleTime > 0.f)
+		{
+			GetWorld()->GetTimerManager().SetTimer(actorPoolEvictionTimer, this, &ThisClass::EvictIdlePooledActors, FMath::Max(pooledActorIdleTime * 0.5f, 1.f), true);
+		}
 	}
 }
 
-void UEquipmentComponent::CycleActiveSlotForward()
+void UEquipmentComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	if (weaponSlots.Num() < numWeaponSlots)
-	{
-		return;
-	}
+	GetWorld()->GetTimerManager().ClearTimer(actorPoolEvictionTimer);
 
-	const int32 OldIndex = (activeSlotIndex < 0 ? weaponSlots.Num() - 1 : activeSlotIndex);
-	int32 NewIndex = activeSlotIndex;
-	do
+	Super::EndPlay(EndPlayReason);
+}
+
+bool UEquipmentComponent::ReplicateSubobjects(UActorChannel* Channel, FOutBunch* Bunch, FReplicationFlags* RepFlags)
+{
+	bool WroteSomething = Super::ReplicateSubobjects(Channel, Bunch, RepFlags);
+
+	for (FAppliedEquipmentEntry& Entry : equipmentList.Entries)
 	{
-		NewIndex = (NewIndex + 1) % weaponSlots.Num();
-		if (weaponSlots[NewIndex] != nullptr)
+		UEquipmentInstance* Instance = Entry.instance;
+
+		if (IsValid(Instance))
 		{
-			SetActiveSlotIndex(NewIndex);
-			return;
+			WroteSomething |= Channel->ReplicateSubobject(Instance, *Bunch, *RepFlags);
 		}
-	} while (NewIndex != OldIndex);
+	}
+
+	return WroteSomething;
 }
 
-void UEquipmentComponent::CycleActiveSlotBackward()
+void UEquipmentComponent::ReadyForReplication()
 {
-	if (weaponSlots.Num() < numWeaponSlots)
-	{
-		return;
-	}
+	Super::ReadyForReplication();
 
-	const int32 OldIndex = (activeSlotIndex < 0 ? weaponSlots.Num() - 1 : activeSlotIndex);
-	int32 NewIndex = activeSlotIndex;
-	do
+	// Register existing equipment instances
+	if (IsUsingRegisteredSubObjectList())
 	{
-		NewIndex = (NewIndex - 1 + weaponSlots.Num()) % weaponSlots.Num();
-		if (weaponSlots[NewIndex] != nullptr)
+		for (const FAppliedEquipmentEntry& Entry : equipmentList.Entries)
 		{
-			SetActiveSlotIndex(NewIndex);
-			return;
+			UEquipmentInstance* Instance = Entry.instance;
+
+			if (IsValid(Instance))
+			{
+				AddReplicatedSubObject(Instance);
+			}
 		}
-	} while (NewIndex != OldIndex);
+	}
 }
 
-UInventoryAbilitySystemComponent* UEquipmentComponent::GetAbilitySystemComponent() const
+UEquipmentInstance* UEquipmentComponent::EquipItemDefinition(TSubclassOf<UEquipmentDefinition> EquipmentDefinition)
 {
-	return Cast<UInventoryAbilitySystemComponent>(UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(GetOwner()));
+	return EquipItemDefinition_Internal(EquipmentDefinition, false);
 }
 
-void UEquipmentComponent::EquipWeaponInSlot()
+UEquipmentInstance* UEquipmentComponent::EquipItemDefinition_Internal(TSubclassOf<UEquipmentDefinition> EquipmentDefinition, bool bDormant)
 {
-	check(weaponSlots.IsValidIndex(activeSlotIndex));
-	check(equippedWeapon == nullptr);
-
-	if (UInventoryItemInstance* SlotItem = weaponSlots[activeSlotIndex])
+	UEquipmentInstance* Result = nullptr;
+	if (EquipmentDefinition)
 	{
-		if (const UInventoryFragment_EquippableItem* EquipInfo = SlotItem->FindFragmentByClass<UInventoryFragment_EquippableItem>())
+		// the equip would touch the assets one by one, load them in one request instead
+		LoadEquipmentNow(EquipmentDefinition);
+
+		Result = equipmentList.AddEntry(EquipmentDefinition, bDormant);
+		if (Result != nullptr)
 		{
-			TSubclassOf<UEquipmentDefinition> EquipDef = EquipInfo->EquipmentDefinition;
-			if (EquipDef != nullptr)
+			if (bBatchingEquips)
 			{
-				equippedWeapon = EquipItemDefinition(EquipDef);
-				if (equippedWeapon != nullptr)
-				{
-					equippedWeapon->SetInstigator(SlotItem);
-				}
+				batchedEquips.Add(Result);
+			}
+			else if (!bDormant)
+			{
+				Result->OnEquipped();
+			}
+
+			if (IsUsingRegisteredSubObjectList() && IsReadyForReplication())
+			{
+				AddReplicatedSubObject(Result);
 			}
 		}
 	}
-}
 
-void UEquipmentComponent::UnequipWeaponInSlot()
+	if (!bDormant && !bBatchingEquips)
+	{
+		OnEquip.Broadcast(Result);
+	}
+	return Result;
+}
+
+void UEquipmentComponent::EquipItemInstance(int32 slotId, UInventoryItemInstance* instance)
+{
+	if (instance) {
+		if (const UInventoryFragment_EquippableItem* EquipInfo = instance->FindFragmentByClass<UInventoryFragment_EquippableItem>())
+		{
+			const int32 slotIndex = GetSlotIndex(FindOrAddCategoryId(EquipInfo->GetClass()), slotId);
+			if (slotIndex == INDEX_NONE)
+			{
+				UE_LOG(LogInventoryAbilitySystem, Warning, TEXT("EquipItemInstance: slot %d is out of range for category %s on %s"), slotId, *GetNameSafe(EquipInfo->GetClass()), *GetNameSafe(GetOwner()));
+				return;
+			}
+
+			// replacing an item, so the previous equipment doesn't keep its abilities and actors
+			if (equippedItems[slotIndex] != nullptr)
+			{
+				UnequipItem(equippedItems[slotIndex]);
+				equippedItems[slotIndex] = nullptr;
+			}
+			FreeBodySlots(equipmentSlots[slotIndex]);
+
+			// items in other slots that share a body slot come off, the stats are refreshed once with the new item below
+			for (uint32 conflicts = instance->GetBodySlotMask() & occupiedBodySlots; conflicts != 0; conflicts = instance->GetBodySlotMask() & occupiedBodySlots)
+			{
+				const int32 bit = FMath::CountTrailingZeros(conflicts);
+				const int32 conflictIndex = bodySlotIndices[bit];
+				if (!equipmentSlots.IsValidIndex(conflictIndex) || equipmentSlots[conflictIndex] != bodySlotItems[bit])
+				{
+					// stale occupancy, never expected
+					ensure(false);
+					occupiedBodySlots &= ~conflicts;
+					break;
+				}
+				RemoveItemAtSlotIndex(conflictIndex, false);
+			}
+
+			TObjectPtr<UEquipmentInstance> NewEquipment;
+			TSubclassOf<UEquipmentDefinition> EquipDef = EquipInfo->EquipmentDefinition;
+			if (EquipDef != nullptr)
+			{
+				NewEquipment = EquipItemDefinition(EquipDef);
+				if (NewEquipment)
+				{
+					NewEquipment->SetInstigator(instance);
+				}
+			}
+
+			equipmentSlots[slotIndex] = instance;
+			equippedItems[slotIndex] = NewEquipment;
+			OccupyBodySlots(instance, slotIndex);
+
+			if (!bBatchingEquips)
+				RefreshEquipmentStats();
+		}
+		return;
+	}
+}
+
+UInventoryItemInstance* UEquipmentComponent::RemoveItemInstance(int32 slotId, TSubclassOf<UInventoryFragment_EquippableItem> type)
+{
+	const int32 slotIndex = GetSlotIndex(FindCategoryId(type), slotId);
+	return slotIndex != INDEX_NONE ? RemoveItemAtSlotIndex(slotIndex) : nullptr;
+}
+
+UInventoryItemInstance* UEquipmentComponent::RemoveItemAtSlotIndex(int32 slotIndex, bool bRefreshStats)
+{
+	UInventoryItemInstance* Result = equipmentSlots[slotIndex];
+	if (Result)
+	{
+		UnequipItem(equippedItems[slotIndex]);
+		FreeBodySlots(Result);
+		equipmentSlots[slotIndex] = nullptr;
+		equippedItems[slotIndex] = nullptr;
+
+		if (bRefreshStats && !bBatchingEquips)
+			RefreshEquipmentStats();
+	}
+	return Result;
+}
+
+void UEquipmentComponent::OccupyBodySlots(UInventoryItemInstance* item, int32 slotIndex)
+{
+	const uint32 mask = item->GetBodySlotMask();
+	occupiedBodySlots |= mask;
+	for (uint32 bits = mask; bits != 0; bits &= bits - 1)
+	{
+		const int32 bit = FMath::CountTrailingZeros(bits);
+		bodySlotItems[bit] = item;
+		bodySlotIndices[bit] = slotIndex;
+	}
+}
+
+void UEquipmentComponent::FreeBodySlots(const UInventoryItemInstance* item)
+{
+	if (item == nullptr)
+		return;
+
+	for (uint32 bits = item->GetBodySlotMask() & occupiedBodySlots; bits != 0; bits &= bits - 1)
+	{
+		const int32 bit = FMath::CountTrailingZeros(bits);
+		if (bodySlotItems[bit] == item)
+		{
+			bodySlotItems[bit] = nullptr;
+			occupiedBodySlots &= ~(1u << bit);
+		}
+	}
+}
+
+bool UEquipmentComponent::CanEquipWithoutConflict(const UInventoryItemInstance* item) const
+{
+	return item && (item->GetBodySlotMask() & occupiedBodySlots) == 0;
+}
+
+void UEquipmentComponent::GetBodySlotConflicts(const UInventoryItemInstance* item, TArray<UInventoryItemInstance*>& outConflicts) const
+{
+	outConflicts.Reset();
+	if (item == nullptr)
+		return;
+
+	for (uint32 bits = item->GetBodySlotMask() & occupiedBodySlots; bits != 0; bits &= bits - 1)
+	{
+		outConflicts.AddUnique(bodySlotItems[FMath::CountTrailingZeros(bits)]);
+	}
+}
+
+int32 UEquipmentComponent::FindSlotForItem(const UInventoryItemInstance* item) const
+{
+	const UInventoryFragment_EquippableItem* EquipInfo = item ? item->FindFragmentByClass<UInventoryFragment_EquippableItem>() : nullptr;
+	if (EquipInfo == nullptr || EquipInfo->IsA(UInventoryFragment_WeaponItem::StaticClass()))
+		return INDEX_NONE;
+
+	const int32 categoryId = FindCategoryId(EquipInfo->GetClass());
+	if (categoryId == INDEX_NONE)
+		return 0;
+
+	const int32 firstIndex = categorySlotOffsets[categoryId];
+	const int32 numSlots = categorySlotCounts[categoryId];
+
+	// taking over the slot of an item that comes off anyway keeps the others in place
+	if (const uint32 conflicts = item->GetBodySlotMask() & occupiedBodySlots)
+	{
+		const int32 conflictIndex = bodySlotIndices[FMath::CountTrailingZeros(conflicts)];
+		if (conflictIndex >= firstIndex && conflictIndex < firstIndex + numSlots)
+			return conflictIndex - firstIndex;
+	}
+
+	for (int32 slotId = 0; slotId < numSlots; ++slotId)
+	{
+		if (equipmentSlots[firstIndex + slotId] == nullptr)
+			return slotId;
+	}
+	return INDEX_NONE;
+}
+
+void UEquipmentComponent::UnequipItem(UEquipmentInstance* ItemInstance)
+{
+	if (ItemInstance)
+	{
+		if (IsUsingRegisteredSubObjectList())
+		{
+			RemoveReplicatedSubObject(ItemInstance);
+		}
+
+		// dormant equipment never ran OnEquipped
+		if (!ItemInstance->IsDormant())
+		{
+			ItemInstance->OnUnequipped();
+			OnUnequip.Broadcast(ItemInstance);
+		}
+
+		equipmentList.RemoveEntry(ItemInstance);
+	}
+}
+
+void UEquipmentComponent::UnequipEverything()
+{
+	TArray<UEquipmentInstance*> AllEquipmentInstances;
+
+	// gathering all instances before removal to avoid side effects affecting the equipment list iterator	
+	for (const FAppliedEquipmentEntry& Entry : equipmentList.Entries)
+	{
+		AllEquipmentInstances.Add(Entry.instance);
+	}
+
+	for (UEquipmentInstance* EquipInstance : AllEquipmentInstances)
+	{
+		UnequipItem(EquipInstance);
+	}
+
+	equippedWeapon = nullptr;
+	weaponInstances.Reset();
+}
+
+UEquipmentInstance* UEquipmentComponent::GetFirstInstanceOfType(TSubclassOf<UEquipmentInstance> InstanceType)
+{
+	TConstArrayView<UEquipmentInstance*> Instances = GetInstancesOfType(InstanceType);
+	return Instances.Num() > 0 ? Instances[0] : nullptr;
+}
+
+TArray<UEquipmentInstance*> UEquipmentComponent::GetEquipmentInstancesOfType(TSubclassOf<UEquipmentInstance> InstanceType) const
+{
+	return TArray<UEquipmentInstance*>(GetInstancesOfType(InstanceType));
+}
+
+TArray<UInventoryItemInstance*> UEquipmentComponent::GetSlots(TSubclassOf<UInventoryFragment_EquippableItem> type) const
+{
+	if (type->IsChildOf(UInventoryFragment_WeaponItem::StaticClass()))
+		return weaponSlots;
+	else
+	{
+		TArray<UInventoryItemInstance*> Results;
+		const int32 categoryId = FindCategoryId(type);
+		if (categoryId != INDEX_NONE)
+		{
+			Results.Reserve(categorySlotCounts[categoryId]);
+			for (int32 slotId = 0; slotId < categorySlotCounts[categoryId]; ++slotId)
+			{
+				Results.Add(equipmentSlots[categorySlotOffsets[categoryId] + slotId]);
+			}
+		}
+		return Results;
+	}
+}
+
+int32 UEquipmentComponent::GetNextFreeWeaponSlot()
+{
+	int32 SlotIndex = 0;
+	for (TObjectPtr<UInventoryItemInstance> ItemPtr : weaponSlots)
+	{
+		if (ItemPtr == nullptr)
+		{
+			return SlotIndex;
+		}
+		++SlotIndex;
+	}
+
+	return INDEX_NONE;
+}
+
+bool UEquipmentComponent::IsItemInSlot(const UInventoryItemInstance* item) const
+{
+	return item && (weaponSlots.Contains(item) || equipmentSlots.Contains(item));
+}
+
+void UEquipmentComponent::MulticastProjectileVolley_Implementation(const UProjectileDefinition* definition, FVector_NetQuantize origin, FVector_NetQuantizeNormal aimDirection, float spreadAngle, float spreadExponent, uint8 numPellets, int32 seed)
+{
+	if (GetOwner()->HasAuthority() || IsLocallyControlled())
+		return;
+
+	UProjectileSubsystem* Projectiles = GetWorld()->GetSubsystem<UProjectileSubsystem>();
+	if (!definition || !Projectiles)
+		return;
+
+	// spawned with the ability system of a proxy, the copy never deals damage and doesn't hit the shooter
+	for (int32 shotIndex = 0; shotIndex < numPellets; ++shotIndex)
+	{
+		const FVector direction = UInventoryGameplayAbility_RangedWeapon::SampleSpreadCone(aimDirection, spreadAngle * 0.5f, spreadExponent, UInventoryGameplayAbility_RangedWeapon::GetShotSeed(seed, shotIndex));
+		Projectiles->SpawnProjectile(definition, origin, direction, nullptr, GetAbilitySystemComponent());
+	}
+}
+
+void UEquipmentComponent::AddItemToSlot(int32 slotId, UInventoryItemInstance* item)
+{
+	PreloadItem(item);
+
+	if (const UInventoryFragment_EquippableItem* EquipInfo = item->FindFragmentByClass<UInventoryFragment_EquippableItem>())
+	{
+		if (EquipInfo->IsA(UInventoryFragment_WeaponItem::StaticClass()))
+		{
+			if (weaponSlots.Num() < numWeaponSlots)
+				weaponSlots.AddDefaulted(numWeaponSlots - weaponSlots.Num());
+
+			if (weaponSlots.IsValidIndex(slotId) && item)
+			{
+				if (bKeepWeaponAbilitiesGranted)
+					EquipDormantWeapon(slotId, item);
+				else
+					weaponSlots[slotId] = item;
+				UpdateOccupiedWeaponSlots();
+			}
+		}
+		else
+			EquipItemInstance(slotId, item);
+	}
+}
+
+void UEquipmentComponent::ApplyLoadout(TConstArrayView<FEquipmentLoadoutEntry> loadout)
+{
+	check(GetOwner()->HasAuthority());
+
+	// a loadout still waiting for its assets is replaced by the new one
+	bLoadoutPending = true;
+	pendingLoadoutSlots.Reset();
+	pendingLoadoutItems.Reset();
+
+	bool bWaitForPreload = false;
+	for (const FEquipmentLoadoutEntry& entry : loadout)
+	{
+		const UInventoryFragment_EquippableItem* EquipInfo = entry.Item ? entry.Item->FindFragmentByClass<UInventoryFragment_EquippableItem>() : nullptr;
+		if (EquipInfo == nullptr)
+			continue;
+
+		pendingLoadoutSlots.Add(entry.SlotId);
+		pendingLoadoutItems.Add(entry.Item);
+
+		// respawns don't load on the game thread, the loadout waits for the preloads of the equipment it adds
+		if (bDeferEquipUntilLoaded && GetItemInSlot(entry.SlotId, EquipInfo) != entry.Item)
+		{
+			PreloadEquipment(EquipInfo->EquipmentDefinition);
+			bWaitForPreload |= IsPreloadInProgress(EquipInfo->EquipmentDefinition);
+		}
+	}
+
+	if (bWaitForPreload)
+	{
+		FEquipmentPreloadStats::Get().NumEquipsDeferred++;
+		return;
+	}
+
+	ApplyPendingLoadout();
+}
+
+void UEquipmentComponent::ApplyPendingLoadout()
+{
+	bLoadoutPending = false;
+	const TArray<int32> slots = MoveTemp(pendingLoadoutSlots);
+	const TArray<TObjectPtr<UInventoryItemInstance>> items = MoveTemp(pendingLoadoutItems);
+	pendingLoadoutSlots.Reset();
+	pendingLoadoutItems.Reset();
+
+	auto IsInTargetSlot = [&](int32 slotId, const UInventoryItemInstance* item)
+	{
+		for (int32 i = 0; i < items.Num(); ++i)
+		{
+			if (items[i] == item && slots[i] == slotId)
+				return true;
+		}
+		return false;
+	};
+
+	// slotted items the loadout doesn't list, or lists for another slot, come off
+	TArray<TPair<int32, TSubclassOf<UInventoryFragment_EquippableItem>>> toRemove;
+	bool bTouchesActiveSlot = false;
+	for (int32 slotId = 0; slotId < weaponSlots.Num(); ++slotId)
+	{
+		if (weaponSlots[slotId] != nullptr && !IsInTargetSlot(slotId, weaponSlots[slotId]))
+		{
+			toRemove.Emplace(slotId, UInventoryFragment_WeaponItem::StaticClass());
+			bTouchesActiveSlot |= slotId == activeSlotIndex;
+		}
+	}
+	for (int32 categoryId = 0; categoryId < equipmentCategories.Num(); ++categoryId)
+	{
+		const int32 categoryEnd = categorySlotOffsets.IsValidIndex(categoryId + 1) ? categorySlotOffsets[categoryId + 1] : equipmentSlots.Num();
+		for (int32 slotIndex = categorySlotOffsets[categoryId]; slotIndex < categoryEnd; ++slotIndex)
+		{
+			const int32 slotId = slotIndex - categorySlotOffsets[categoryId];
+			if (equipmentSlots[slotIndex] != nullptr && !IsInTargetSlot(slotId, equipmentSlots[slotIndex]))
+				toRemove.Emplace(slotId, equipmentCategories[categoryId]);
+		}
+	}
+
+	// the slot already holds the item, its abilities and actors stay as they are
+	TArray<int32> toApply;
+	for (int32 i = 0; i < items.Num(); ++i)
+	{
+		const UInventoryFragment_EquippableItem* EquipInfo = items[i] ? items[i]->FindFragmentByClass<UInventoryFragment_EquippableItem>() : nullptr;
+		if (EquipInfo == nullptr || GetItemInSlot(slots[i], EquipInfo) == items[i])
+			continue;
+
+		toApply.Add(i);
+		bTouchesActiveSlot |= EquipInfo->IsA(UInventoryFragment_WeaponItem::StaticClass()) && slots[i] == activeSlotIndex;
+	}
+
+	if (toRemove.Num() == 0 && toApply.Num() == 0)
+		return;
+
+	// the active weapon is equipped again after the batch, so it doesn't wake before its actors exist
+	const int32 prevActiveSlot = activeSlotIndex;
+	if (bTouchesActiveSlot)
+	{
+		UnequipWeaponInSlot();
+		activeSlotIndex = INDEX_NONE;
+	}
+
+	// equipment that didn't finish preloading is loaded by the equip and counted as a sync load
+	BeginEquipBatch();
+	for (const TPair<int32, TSubclassOf<UInventoryFragment_EquippableItem>>& removal : toRemove)
+	{
+		RemoveItemFromSlot(removal.Key, removal.Value);
+	}
+	for (int32 i : toApply)
+	{
+		AddItemToSlot(slots[i], items[i]);
+	}
+	EndEquipBatch();
+
+	if (bTouchesActiveSlot)
+	{
+		activeSlotIndex = prevActiveSlot;
+		EquipWeaponInSlot();
+	}
+}
+
+bool UEquipmentComponent::IsPendingLoadoutLoading() const
+{
+	for (const UInventoryItemInstance* item : pendingLoadoutItems)
+	{
+		const UInventoryFragment_EquippableItem* EquipInfo = item ? item->FindFragmentByClass<UInventoryFragment_EquippableItem>() : nullptr;
+		if (EquipInfo && IsPreloadInProgress(EquipInfo->EquipmentDefinition))
+			return true;
+	}
+	return false;
+}
+
+UInventoryItemInstance* UEquipmentComponent::GetItemInSlot(int32 slotId, const UInventoryFragment_EquippableItem* EquipInfo) const
+{
+	if (EquipInfo->IsA(UInventoryFragment_WeaponItem::StaticClass()))
+		return weaponSlots.IsValidIndex(slotId) ? weaponSlots[slotId] : nullptr;
+
+	const int32 slotIndex = GetSlotIndex(FindCategoryId(EquipInfo->GetClass()), slotId);
+	return slotIndex != INDEX_NONE ? equipmentSlots[slotIndex] : nullptr;
+}
+
+void UEquipmentComponent::BeginEquipBatch()
+{
+	check(!bBatchingEquips);
+	bBatchingEquips = true;
+	batchedEquips.Reset();
+}
+
+void UEquipmentComponent::EndEquipBatch()
+{
+	check(bBatchingEquips);
+	bBatchingEquips = false;
+
+	// equipment replaced again within the batch was already removed from the list
+	TArray<UEquipmentInstance*> NewEquipment;
+	NewEquipment.Reserve(batchedEquips.Num());
+	for (FAppliedEquipmentEntry& Entry : equipmentList.Entries)
+	{
+		if (Entry.instance != nullptr && batchedEquips.Contains(Entry.instance))
+		{
+			Entry.instance->SpawnEquipmentActors(GetDefault<UEquipmentDefinition>(Entry.equipmentDefinition)->ActorsToSpawn);
+			Entry.instance->SetDormant(Entry.bDormant);
+			if (!Entry.bDormant)
+				NewEquipment.Add(Entry.instance);
+		}
+	}
+	batchedEquips.Reset();
+
+	// dormant equipment never runs OnEquipped, same as outside of a batch
+	for (UEquipmentInstance* Equipment : NewEquipment)
+	{
+		Equipment->OnEquipped();
+	}
+
+	RefreshEquipmentStats();
+
+	OnEquipBatch.Broadcast(NewEquipment);
+}
+
+void UEquipmentComponent::RefreshEquipmentStats()
+{
+	if (!equipmentStatEffect || !GetOwner()->HasAuthority())
+		return;
+
+	UInventoryAbilitySystemComponent* ASC = GetAbilitySystemComponent();
+	if (ASC == nullptr)
+		return;
+
+	TArray<FGameplayTag> statTags;
+	GetDefault<UInventoryGameplayEffect_EquipmentStats>(equipmentStatEffect)->GetStatTags(statTags);
+
+	TMap<FGameplayTag, float> magnitudes;
+	magnitudes.Reserve(statTags.Num());
+	bool bAnyStat = false;
+	for (const FGameplayTag& statTag : statTags)
+	{
+		float& magnitude = magnitudes.Add(statTag, 0.f);
+		for (const UInventoryItemInstance* item : equipmentSlots)
+		{
+			if (item)
+				magnitude += item->GetStatTagStackCount(statTag);
+		}
+		bAnyStat |= magnitude != 0.f;
+	}
+
+	const bool bApplied = equipmentStatHandle.IsValid() && ASC->GetActiveGameplayEffect(equipmentStatHandle) != nullptr;
+	if (bApplied)
+	{
+		if (magnitudes.OrderIndependentCompareEqual(equipmentStatMagnitudes))
+			return;
+
+		// the active effect keeps its handle, only its modifiers are aggregated again
+		ASC->UpdateActiveGameplayEffectSetByCallerMagnitudes(equipmentStatHandle, magnitudes);
+	}
+	else if (bAnyStat)
+	{
+		FGameplayEffectSpecHandle specHandle = ASC->MakeOutgoingSpec(equipmentStatEffect, 1.f, ASC->MakeEffectContext());
+		for (const TPair<FGameplayTag, float>& pair : magnitudes)
+		{
+			specHandle.Data->SetSetByCallerMagnitude(pair.Key, pair.Value);
+		}
+		equipmentStatHandle = ASC->ApplyGameplayEffectSpecToSelf(*specHandle.Data.Get());
+	}
+
+	equipmentStatMagnitudes = MoveTemp(magnitudes);
+}
+
+UInventoryItemInstance* UEquipmentComponent::RemoveItemFromSlot(int32 slotId, TSubclassOf<UInventoryFragment_EquippableItem> type)
+{
+	UInventoryItemInstance* Result = nullptr;
+
+	if (type->IsChildOf(UInventoryFragment_WeaponItem::StaticClass()))
+	{
+		if (activeSlotIndex == slotId)
+		{
+			UnequipWeaponInSlot();
+			activeSlotIndex = -1;
+			replicatedWeaponSlot.SlotIndex = activeSlotIndex;
+		}
+
+		if (weaponSlots.IsValidIndex(slotId))
+		{
+			Result = weaponSlots[slotId];
+
+			if (Result != nullptr)
+			{
+				weaponSlots[slotId] = nullptr;
+				UpdateOccupiedWeaponSlots();
+			}
+		}
+
+		if (weaponInstances.IsValidIndex(slotId) && weaponInstances[slotId] != nullptr)
+		{
+			UnequipItem(weaponInstances[slotId]);
+			weaponInstances[slotId] = nullptr;
+		}
+	}
+	else
+	{
+		Result = RemoveItemInstance(slotId, type);
+	}
+
+	return Result;
+}
+
+void UEquipmentComponent::SetActiveSlotIndex(int32 newId)
+{
+	if (GetOwner()->HasAuthority())
+	{
+		SetActiveSlotIndex_Internal(newId);
+	}
+	else if (IsLocallyControlled() && newId >= 0 && newId < numWeaponSlots && activeSlotIndex != newId)
+	{
+		PredictActiveSlotIndex(newId);
+		ServerSetActiveSlotIndex(newId, ++predictedSwitchId);
+	}
+}
+
+void UEquipmentComponent::ServerSetActiveSlotIndex_Implementation(int32 newId, uint8 switchId)
+{
+	// invalid slots are not applied, the ack still goes out so the client reconciles to the current slot
+	SetActiveSlotIndex_Internal(newId);
+	replicatedWeaponSlot.SwitchId = switchId;
+}
+
+void UEquipmentComponent::SetActiveSlotIndex_Internal(int32 newId)
+{
+	if (weaponSlots.IsValidIndex(newId) && (activeSlotIndex != newId)) {
+		UnequipWeaponInSlot();
+
+		activeSlotIndex = newId;
+		replicatedWeaponSlot.SlotIndex = activeSlotIndex;
+
+		EquipWeaponInSlot();
+
+		OnWeaponSlotChanged.Broadcast(activeSlotIndex);
+	}
+}
+
+void UEquipmentComponent::PredictActiveSlotIndex(int32 newId)
+{
+	// only dormant weapons exist on the client before the server equipped them, otherwise just the slot is predicted
+	if (UEquipmentInstance* OldWeapon = GetWeaponInstance(activeSlotIndex))
+		equipmentList.PredictEntryDormant(OldWeapon, true);
+
+	activeSlotIndex = newId;
+
+	if (UEquipmentInstance* NewWeapon = GetWeaponInstance(activeSlotIndex))
+		equipmentList.PredictEntryDormant(NewWeapon, false);
+
+	OnWeaponSlotChanged.Broadcast(activeSlotIndex);
+}
+
+void UEquipmentComponent::OnRep_ReplicatedWeaponSlot()
+{
+	// a newer switch is still on its way, its ack carries the state to reconcile with
+	if (IsPredictingWeaponSwitch())
+		return;
+
+	if (activeSlotIndex != replicatedWeaponSlot.SlotIndex)
+	{
+		activeSlotIndex = replicatedWeaponSlot.SlotIndex;
+		OnWeaponSlotChanged.Broadcast(activeSlotIndex);
+	}
+
+	// correctly predicted entries already match their replicated dormant state and are left alone
+	equipmentList.ReconcileLocally();
+}
+
+bool UEquipmentComponent::IsLocallyControlled() const
+{
+	const APawn* Pawn = Cast<APawn>(GetOwner());
+	return Pawn && Pawn->IsLocallyControlled();
+}
+
+bool UEquipmentComponent::IsPredictingWeaponSwitch() const
+{
+	return !GetOwner()->HasAuthority() && predictedSwitchId != replicatedWeaponSlot.SwitchId && IsLocallyControlled();
+}
+
+void UEquipmentComponent::UpdateOccupiedWeaponSlots()
+{
+	occupiedWeaponSlots = 0;
+	for (int32 slotId = 0; slotId < FMath::Min(weaponSlots.Num(), 32); ++slotId)
+	{
+		if (weaponSlots[slotId] != nullptr)
+			occupiedWeaponSlots |= (1 << slotId);
+	}
+}
+
+void UEquipmentComponent::CycleActiveSlotForward()
+{
+	if (occupiedWeaponSlots == 0)
+	{
+		return;
+	}
+
+	const int32 OldIndex = (activeSlotIndex < 0 ? numWeaponSlots - 1 : activeSlotIndex);
+	int32 NewIndex = OldIndex;
+	do
+	{
+		NewIndex = (NewIndex + 1) % numWeaponSlots;
+		if (IsWeaponSlotOccupied(NewIndex))
+		{
+			SetActiveSlotIndex(NewIndex);
+			return;
+		}
+	} while (NewIndex != OldIndex);
+}
+
+void UEquipmentComponent::CycleActiveSlotBackward()
+{
+	if (occupiedWeaponSlots == 0)
+	{
+		return;
+	}
+
+	const int32 OldIndex = (activeSlotIndex < 0 ? numWeaponSlots - 1 : activeSlotIndex);
+	int32 NewIndex = OldIndex;
+	do
+	{
+		NewIndex = (NewIndex - 1 + numWeaponSlots) % numWeaponSlots;
+		if (IsWeaponSlotOccupied(NewIndex))
+		{
+			SetActiveSlotIndex(NewIndex);
+			return;
+		}
+	} while (NewIndex != OldIndex);
+}
+
+UInventoryAbilitySystemComponent* UEquipmentComponent::GetAbilitySystemComponent() const
+{
+	return Cast<UInventoryAbilitySystemComponent>(UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(GetOwner()));
+}
+
+int32 UEquipmentComponent::AddCategory(TSubclassOf<UInventoryFragment_EquippableItem> category, int32 numSlots)
+{
+	numSlots = FMath::Max(numSlots, 1);
+
+	const int32 categoryId = equipmentCategories.Add(category);
+	categorySlotOffsets.Add(equipmentSlots.Num());
+	categorySlotCounts.Add(numSlots);
+	equipmentSlots.AddDefaulted(numSlots);
+	equippedItems.AddDefaulted(numSlots);
+
+	return categoryId;
+}
+
+int32 UEquipmentComponent::FindCategoryId(TSubclassOf<UInventoryFragment_EquippableItem> fragmentClass) const
+{
+	if (!fragmentClass)
+		return INDEX_NONE;
+
+	if (const int32* categoryId = categoryIds.Find(fragmentClass))
+		return *categoryId;
+
+	// fragments deriving from a configured category share its slots
+	for (int32 categoryId = 0; categoryId < equipmentCategories.Num(); ++categoryId)
+	{
+		if (fragmentClass->IsChildOf(equipmentCategories[categoryId]))
+			return categoryId;
+	}
+
+	return INDEX_NONE;
+}
+
+int32 UEquipmentComponent::FindOrAddCategoryId(TSubclassOf<UInventoryFragment_EquippableItem> fragmentClass)
+{
+	if (const int32* categoryId = categoryIds.Find(fragmentClass))
+		return *categoryId;
+
+	if (!fragmentClass)
+		return INDEX_NONE;
+
+	int32 categoryId = FindCategoryId(fragmentClass);
+	if (categoryId == INDEX_NONE)
+	{
+		categoryId = AddCategory(fragmentClass, defaultCategorySlots);
+	}
+
+	categoryIds.Add(fragmentClass, categoryId);
+	return categoryId;
+}
+
+int32 UEquipmentComponent::GetSlotIndex(int32 categoryId, int32 slotId) const
 {
+	if (categorySlotCounts.IsValidIndex(categoryId) && slotId >= 0 && slotId < categorySlotCounts[categoryId])
+	{
+		return categorySlotOffsets[categoryId] + slotId;
+	}
+	return INDEX_NONE;
+}
+
+void UEquipmentComponent::EquipWeaponInSlot()
+{
+	check(weaponSlots.IsValidIndex(activeSlotIndex));
+	check(equippedWeapon == nullptr);
+
+	if (bKeepWeaponAbilitiesGranted)
+	{
+		if (weaponInstances.IsValidIndex(activeSlotIndex) && weaponInstances[activeSlotIndex] != nullptr)
+		{
+			equippedWeapon = weaponInstances[activeSlotIndex];
+			SetEquipmentDormant(equippedWeapon, false);
+		}
+		return;
+	}
+
+	if (UInventoryItemInstance* SlotItem = weaponSlots[activeSlotIndex])
+	{
+		if (const UInventoryFragment_EquippableItem* EquipInfo = SlotItem->FindFragmentByClass<UInventoryFragment_EquippableItem>())
+		{
+			TSubclassOf<UEquipmentDefinition> EquipDef = EquipInfo->EquipmentDefinition;
+
+			// the preload is still running, finish the equip in OnPreloadCompleted
+			if (EquipDef != nullptr && bDeferEquipUntilLoaded && IsPreloadInProgress(EquipDef))
+			{
+				pendingWeaponSlot = activeSlotIndex;
+				FEquipmentPreloadStats::Get().NumEquipsDeferred++;
+				return;
+			}
+
+			if (EquipDef != nullptr)
+			{
+				equippedWeapon = EquipItemDefinition(EquipDef);
+				if (equippedWeapon != nullptr)
+				{
+					equippedWeapon->SetInstigator(SlotItem);
+				}
+			}
+		}
+	}
+}
+
+void UEquipmentComponent::UnequipWeaponInSlot()
+{
+	pendingWeaponSlot = INDEX_NONE;
+
 	if (equippedWeapon != nullptr)
 	{
-		UnequipItem(equippedWeapon);
+		if (bKeepWeaponAbilitiesGranted)
+			SetEquipmentDormant(equippedWeapon, true);
+		else
+			UnequipItem(equippedWeapon);
 		equippedWeapon = nullptr;
 	}
 }
+
+void UEquipmentComponent::EquipDormantWeapon(int32 slotId, UInventoryItemInstance* item)
+{
+	if (weaponInstances.Num() < weaponSlots.Num())
+		weaponInstances.AddDefaulted(weaponSlots.Num() - weaponInstances.Num());
+
+	const bool bActiveSlot = (slotId == activeSlotIndex);
+	if (bActiveSlot)
+		UnequipWeaponInSlot();
+
+	if (weaponInstances[slotId] != nullptr)
+	{
+		UnequipItem(weaponInstances[slotId]);
+		weaponInstances[slotId] = nullptr;
+	}
+
+	weaponSlots[slotId] = item;
+	UpdateOccupiedWeaponSlots();
+
+	if (const UInventoryFragment_EquippableItem* EquipInfo = item->FindFragmentByClass<UInventoryFragment_EquippableItem>())
+	{
+		if (UEquipmentInstance* NewEquipment = EquipItemDefinition_Internal(EquipInfo->EquipmentDefinition, /*bDormant=*/ true))
+		{
+			NewEquipment->SetInstigator(item);
+			weaponInstances[slotId] = NewEquipment;
+		}
+	}
+
+	if (bActiveSlot)
+		EquipWeaponInSlot();
+}
+
+void UEquipmentComponent::SetEquipmentDormant(UEquipmentInstance* ItemInstance, bool bDormant)
+{
+	if (ItemInstance == nullptr || ItemInstance->IsDormant() == bDormant)
+		return;
+
+	if (bDormant)
+	{
+		// abilities still running from this weapon would otherwise keep going while it is put away
+		if (UInventoryAbilitySystemComponent* ASC = GetAbilitySystemComponent())
+		{
+			ASC->CancelAbilitiesByFunc([ASC, ItemInstance](const UInventoryGameplayAbility* Ability, FGameplayAbilitySpecHandle Handle)
+				{
+					const FGameplayAbilitySpec* Spec = ASC->FindAbilitySpecFromHandle(Handle);
+					return Spec && Spec->SourceObject.Get() == ItemInstance;
+				}, /*bReplicateCancelAbility=*/ true);
+		}
+
+		ItemInstance->OnUnequipped();
+		OnUnequip.Broadcast(ItemInstance);
+		ItemInstance->SetDormant(true);
+	}
+	else
+	{
+		ItemInstance->SetDormant(false);
+		ItemInstance->OnEquipped();
+		OnEquip.Broadcast(ItemInstance);
+	}
+
+	equipmentList.SetEntryDormant(ItemInstance, bDormant);
+}
+
+void UEquipmentComponent::PreloadEquipment(TSubclassOf<UEquipmentDefinition> EquipmentDefinition)
+{
+	if (!EquipmentDefinition || preloadHandles.Contains(EquipmentDefinition))
+		return;
+
+	TArray<FSoftObjectPath> assets;
+	GetDefault<UEquipmentDefinition>(EquipmentDefinition)->GatherAssetsToLoad(assets);
+	if (assets.Num() == 0)
+	{
+		residentDefinitions.Add(EquipmentDefinition);
+		return;
+	}
+
+	FEquipmentPreloadStats::Get().NumPreloadsStarted++;
+	preloadHandles.Add(EquipmentDefinition, UAssetManager::GetStreamableManager().RequestAsyncLoad(assets,
+		FStreamableDelegate::CreateUObject(this, &ThisClass::OnPreloadCompleted, EquipmentDefinition)));
+}
+
+void UEquipmentComponent::PreloadItem(UInventoryItemInstance* item)
+{
+	if (item)
+	{
+		if (const UInventoryFragment_EquippableItem* EquipInfo = item->FindFragmentByClass<UInventoryFragment_EquippableItem>())
+		{
+			PreloadEquipment(EquipInfo->EquipmentDefinition);
+		}
+	}
+}
+
+bool UEquipmentComponent::IsEquipmentResident(TSubclassOf<UEquipmentDefinition> EquipmentDefinition) const
+{
+	return !EquipmentDefinition || residentDefinitions.Contains(EquipmentDefinition);
+}
+
+bool UEquipmentComponent::IsPreloadInProgress(TSubclassOf<UEquipmentDefinition> EquipmentDefinition) const
+{
+	const TSharedPtr<FStreamableHandle>* handle = preloadHandles.Find(EquipmentDefinition);
+	return handle && handle->IsValid() && (*handle)->IsLoadingInProgress();
+}
+
+void UEquipmentComponent::LoadEquipmentNow(TSubclassOf<UEquipmentDefinition> EquipmentDefinition)
+{
+	if (IsEquipmentResident(EquipmentDefinition))
+	{
+		FEquipmentPreloadStats::Get().NumEquipsResident++;
+		return;
+	}
+
+	TArray<FSoftObjectPath> assets;
+	GetDefault<UEquipmentDefinition>(EquipmentDefinition)->GatherAssetsToLoad(assets);
+	if (assets.ContainsByPredicate([](const FSoftObjectPath& asset) { return asset.ResolveObject() == nullptr; }))
+	{
+		FEquipmentPreloadStats::Get().NumSyncLoads++;
+		UE_LOG(LogInventoryAbilitySystem, Verbose, TEXT("Equipping %s before its assets were preloaded, loading synchronously"), *GetNameSafe(EquipmentDefinition));
+	}
+	else
+	{
+		FEquipmentPreloadStats::Get().NumEquipsResident++;
+	}
+
+	TSharedPtr<FStreamableHandle> handle = assets.Num() > 0 ? UAssetManager::GetStreamableManager().RequestSyncLoad(assets) : nullptr;
+
+	// a running preload keeps its handle and marks the definition resident once it completes
+	if (IsPreloadInProgress(EquipmentDefinition))
+		return;
+
+	// the handle keeps the assets loaded, so the definition is never checked again
+	preloadHandles.Add(EquipmentDefinition, handle);
+	residentDefinitions.Add(EquipmentDefinition);
+}
+
+void UEquipmentComponent::OnPreloadCompleted(TSubclassOf<UEquipmentDefinition> EquipmentDefinition)
+{
+	residentDefinitions.Add(EquipmentDefinition);
+
+	// clients finish the equips of replicated entries that waited for the assets
+	if (!GetOwner()->HasAuthority())
+	{
+		equipmentList.ReconcileLocally();
+		return;
+	}
+
+	// the loadout waits for the last of its preloads
+	if (bLoadoutPending && !IsPendingLoadoutLoading())
+		ApplyPendingLoadout();
+
+	if (pendingWeaponSlot == INDEX_NONE || pendingWeaponSlot != activeSlotIndex || equippedWeapon != nullptr)
+		return;
+
+	// only finish the equip the slot is still waiting for
+	if (UInventoryItemInstance* SlotItem = weaponSlots[pendingWeaponSlot])
+	{
+		const UInventoryFragment_EquippableItem* EquipInfo = SlotItem->FindFragmentByClass<UInventoryFragment_EquippableItem>();
+		if (EquipInfo && EquipInfo->EquipmentDefinition == EquipmentDefinition)
+		{
+			pendingWeaponSlot = INDEX_NONE;
+			EquipWeaponInSlot();
+		}
+	}
+}
+
+AActor* UEquipmentComponent::AcquireEquipmentActor(const FEquipmentActorToSpawn& SpawnInfo, USceneComponent* AttachTarget)
+{
+	check(GetOwner()->HasAuthority());
+
+	const TSubclassOf<AActor> actorClass = FEquipmentPreloadStats::Resolve(SpawnInfo.ActorToSpawn);
+	if (!actorClass)
+		return nullptr;
+
+	AActor* Actor = nullptr;
+	if (FEquipmentActorPool* pool = actorPools.Find(actorClass))
+	{
+		while (Actor == nullptr && pool->Actors.Num() > 0)
+		{
+			Actor = pool->Actors.Pop(EAllowShrinking::No);
+			pool->ParkTimes.Pop(EAllowShrinking::No);
+			if (!IsValid(Actor))
+				Actor = nullptr;
+		}
+	}
+
+	if (Actor)
+	{
+		// restore what parking turned off
+		const AActor* actorCDO = Actor->GetClass()->GetDefaultObject<AActor>();
+		Actor->SetActorHiddenInGame(actorCDO->IsHidden());
+		Actor->SetActorEnableCollision(actorCDO->GetActorEnableCollision());
+		Actor->SetActorTickEnabled(actorCDO->PrimaryActorTick.bStartWithTickEnabled);
+	}
+	else
+	{
+		Actor = SpawnPooledActor(actorClass);
+	}
+
+	if (Actor)
+	{
+		Actor->SetActorRelativeTransform(SpawnInfo.AttachTransform);
+		Actor->AttachToComponent(AttachTarget, FAttachmentTransformRules::KeepRelativeTransform, SpawnInfo.AttachSocket);
+	}
+	return Actor;
+}
+
+void UEquipmentComponent::ReleaseEquipmentActor(AActor* Actor)
+{
+	if (!IsValid(Actor))
+		return;
+
+	FEquipmentActorPool& pool = actorPools.FindOrAdd(Actor->GetClass());
+	if (pool.Actors.Num() >= GetMaxPooledActors(Actor->GetClass()))
+	{
+		Actor->Destroy();
+		return;
+	}
+
+	Actor->DetachFromActor(FDetachmentTransformRules::KeepWorldTransform);
+	Actor->SetActorHiddenInGame(true);
+	Actor->SetActorEnableCollision(false);
+	Actor->SetActorTickEnabled(false);
+
+	pool.Actors.Add(Actor);
+	pool.ParkTimes.Add(GetWorld()->GetTimeSeconds());
+}
+
+AActor* UEquipmentComponent::SpawnPooledActor(TSubclassOf<AActor> actorClass)
+{
+	APawn* OwningPawn = Cast<APawn>(GetOwner());
+	AActor* NewActor = GetWorld()->SpawnActorDeferred<AActor>(actorClass, FTransform::Identity, GetOwner(), OwningPawn);
+	if (NewActor)
+	{
+		NewActor->FinishSpawning(FTransform::Identity, /*bIsDefaultTransform=*/ true);
+	}
+	return NewActor;
+}
+
+int32 UEquipmentComponent::GetMaxPooledActors(TSubclassOf<AActor> actorClass) const
+{
+	for (const FEquipmentActorPoolConfig& config : actorPoolConfig)
+	{
+		if (config.ActorClass == actorClass)
+			return config.MaxPooled;
+	}
+	return defaultMaxPooledActors;
+}
+
+void UEquipmentComponent::WarmupActorPools()
+{
+	for (const FEquipmentActorPoolConfig& config : actorPoolConfig)
+	{
+		if (!config.ActorClass)
+			continue;
+
+		const int32 warmupCount = FMath::Min(config.WarmupCount, config.MaxPooled);
+		FEquipmentActorPool& pool = actorPools.FindOrAdd(config.ActorClass);
+		while (pool.Actors.Num() < warmupCount)
+		{
+			AActor* Actor = SpawnPooledActor(config.ActorClass);
+			if (!Actor)
+				break;
+			ReleaseEquipmentActor(Actor);
+		}
+	}
+}
+
+void UEquipmentComponent::EvictIdlePooledActors()
+{
+	const double evictBefore = GetWorld()->GetTimeSeconds() - pooledActorIdleTime;
+	for (TPair<TSubclassOf<AActor>, FEquipmentActorPool>& pair : actorPools)
+	{
+		FEquipmentActorPool& pool = pair.Value;
+
+		int32 numEvicted = 0;
+		while (numEvicted < pool.Actors.Num() && pool.ParkTimes[numEvicted] < evictBefore)
+		{
+			if (IsValid(pool.Actors[numEvicted]))
+				pool.Actors[numEvicted]->Destroy();
+			++numEvicted;
+		}
+
+		if (numEvicted > 0)
+		{
+			pool.Actors.RemoveAt(0, numEvicted, EAllowShrinking::No);
+			pool.ParkTimes.RemoveAt(0, numEvicted, EAllowShrinking::No);
+		}
+	}
+}
+
+void UEquipmentComponent::DestroyActorPools()
+{
+	for (TPair<TSubclassOf<AActor>, FEquipmentActorPool>& pair : actorPools)
+	{
+		for (AActor* Actor : pair.Value.Actors)
+		{
+			if (IsValid(Actor))
+				Actor->Destroy();
+		}
+	}
+	actorPools.Empty();
+}
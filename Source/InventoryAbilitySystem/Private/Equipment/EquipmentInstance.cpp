@@ -3,10 +3,39 @@
 
 #include "Equipment/EquipmentInstance.h"
 #include "Equipment/EquipmentComponent.h"
+#include "Equipment/EquipmentTickSubsystem.h"
 #include "Inventory/InventoryCosmeticComponent.h"
 #include "Inventory/IInventory.h"
 #include "GameFramework/Character.h"
 #include "Net/UnrealNetwork.h"
+#include "Ability/InventoryAbilitySystemComponent.h"
+#include "HAL/IConsoleManager.h"
+
+namespace EquipmentCosmetics
+{
+	static int32 CosmeticPolicy = 1;
+	static FAutoConsoleVariableRef CVarCosmeticPolicy(
+		TEXT("Equipment.CosmeticPolicy"),
+		CosmeticPolicy,
+		TEXT("0: equipment cosmetics run everywhere and all equipment actors are replicated\n")
+		TEXT("1: dedicated servers skip anim layers, montages and actors not flagged bGameplayRelevant, clients spawn those actors locally\n")
+		TEXT("Server and clients have to use the same value"),
+		ECVF_Default);
+}
+
+bool UEquipmentInstance::ShouldRunCosmetics(const UObject* WorldContextObject)
+{
+	if (EquipmentCosmetics::CosmeticPolicy == 0)
+		return true;
+
+	const UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	return World ? World->GetNetMode() != NM_DedicatedServer : !IsRunningDedicatedServer();
+}
+
+bool UEquipmentInstance::SpawnsCosmeticActorsLocally()
+{
+	return EquipmentCosmetics::CosmeticPolicy != 0;
+}
 
 UEquipmentInstance::UEquipmentInstance(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
@@ -20,75 +49,240 @@ void UEquipmentInstance::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& O
 
 	DOREPLIFETIME(ThisClass, Instigator);
 	DOREPLIFETIME(ThisClass, SpawnedActors);
+	DOREPLIFETIME(ThisClass, EquipmentDefinition);
+}
+
+USceneComponent* UEquipmentInstance::GetAttachTarget() const
+{
+	APawn* OwningPawn = GetPawn();
+	if (!OwningPawn)
+		return nullptr;
+
+	USceneComponent* AttachTarget = OwningPawn->GetRootComponent();
+	if (OwningPawn->Implements<UInventory>()) {
+		if (USceneComponent* inventoryComponent = IInventory::Execute_GetEquipmentAttachmentComponent(OwningPawn))
+			AttachTarget = inventoryComponent;
+	}
+	else if (ACharacter* Char = Cast<ACharacter>(OwningPawn))
+	{
+		AttachTarget = Char->GetMesh();
+	}
+	return AttachTarget;
 }
 
 void UEquipmentInstance::SpawnEquipmentActors(const TArray<FEquipmentActorToSpawn>& ActorsToSpawn)
 {
 	if (APawn* OwningPawn = GetPawn())
 	{
-		USceneComponent* AttachTarget = OwningPawn->GetRootComponent();
-		if (OwningPawn->Implements<UInventory>()) {
-			if (USceneComponent* inventoryComponent = IInventory::Execute_GetEquipmentAttachmentComponent(OwningPawn))
-				AttachTarget = inventoryComponent;
+		USceneComponent* AttachTarget = GetAttachTarget();
+
+		// weapon swaps reuse the actors parked in the equipment component
+		UEquipmentComponent* EquipmentComponent = OwningPawn->FindComponentByClass<UEquipmentComponent>();
+		const bool bCosmeticsLocal = SpawnsCosmeticActorsLocally();
+
+		for (const FEquipmentActorToSpawn& SpawnInfo : ActorsToSpawn)
+		{
+			// spawned by SpawnCosmeticActors on the machines that show them
+			if (!SpawnInfo.bGameplayRelevant && bCosmeticsLocal)
+				continue;
+
+			AActor* NewActor = nullptr;
+			if (EquipmentComponent)
+			{
+				NewActor = EquipmentComponent->AcquireEquipmentActor(SpawnInfo, AttachTarget);
+			}
+			else
+			{
+				if (TSubclassOf<AActor> ActorClass = FEquipmentPreloadStats::Resolve(SpawnInfo.ActorToSpawn))
+				{
+					NewActor = GetWorld()->SpawnActorDeferred<AActor>(ActorClass, FTransform::Identity, OwningPawn, OwningPawn);
+					NewActor->FinishSpawning(FTransform::Identity, /*bIsDefaultTransform=*/ true);
+					NewActor->SetActorRelativeTransform(SpawnInfo.AttachTransform);
+					NewActor->AttachToComponent(AttachTarget, FAttachmentTransformRules::KeepRelativeTransform, SpawnInfo.AttachSocket);
+				}
+			}
+
+			if (NewActor)
+			{
+				SpawnedActors.Add(NewActor);
+			}
 		}
-		else if (ACharacter* Char = Cast<ACharacter>(OwningPawn))
+		OnEquipmentActorsChanged();
+	}
+}
+
+void UEquipmentInstance::DestroyEquipmentActors()
+{
+	UEquipmentComponent* EquipmentComponent = GetPawn() ? GetPawn()->FindComponentByClass<UEquipmentComponent>() : nullptr;
+
+	for (AActor* Actor : SpawnedActors)
+	{
+		if (Actor)
 		{
-			AttachTarget = Char->GetMesh();
+			if (EquipmentComponent)
+			{
+				EquipmentComponent->ReleaseEquipmentActor(Actor);
+			}
+			else
+			{
+				Actor->Destroy();
+			}
 		}
+	}
+	SpawnedActors.Reset();
+	OnEquipmentActorsChanged();
+}
 
-		for (const FEquipmentActorToSpawn& SpawnInfo : ActorsToSpawn)
+void UEquipmentInstance::SpawnCosmeticActors()
+{
+	if (!SpawnsCosmeticActorsLocally() || !EquipmentDefinition || CosmeticActors.Num() > 0)
+		return;
+
+	APawn* OwningPawn = GetPawn();
+	USceneComponent* AttachTarget = GetAttachTarget();
+	if (!OwningPawn || !AttachTarget)
+		return;
+
+	for (const FEquipmentActorToSpawn& SpawnInfo : GetDefault<UEquipmentDefinition>(EquipmentDefinition)->ActorsToSpawn)
+	{
+		if (SpawnInfo.bGameplayRelevant)
+			continue;
+
+		if (TSubclassOf<AActor> ActorClass = FEquipmentPreloadStats::Resolve(SpawnInfo.ActorToSpawn))
 		{
-			AActor* NewActor = GetWorld()->SpawnActorDeferred<AActor>(SpawnInfo.ActorToSpawn, FTransform::Identity, OwningPawn, OwningPawn);
+			// every machine spawns its own copy, nothing to replicate
+			AActor* NewActor = GetWorld()->SpawnActorDeferred<AActor>(ActorClass, FTransform::Identity, OwningPawn, OwningPawn);
+			NewActor->SetReplicates(false);
 			NewActor->FinishSpawning(FTransform::Identity, /*bIsDefaultTransform=*/ true);
 			NewActor->SetActorRelativeTransform(SpawnInfo.AttachTransform);
 			NewActor->AttachToComponent(AttachTarget, FAttachmentTransformRules::KeepRelativeTransform, SpawnInfo.AttachSocket);
-
-			SpawnedActors.Add(NewActor);
+			NewActor->SetActorHiddenInGame(bDormant);
+			CosmeticActors.Add(NewActor);
 		}
 	}
+	OnEquipmentActorsChanged();
 }
 
-void UEquipmentInstance::DestroyEquipmentActors()
+void UEquipmentInstance::DestroyCosmeticActors()
+{
+	for (AActor* Actor : CosmeticActors)
+	{
+		if (Actor)
+			Actor->Destroy();
+	}
+	CosmeticActors.Reset();
+	OnEquipmentActorsChanged();
+}
+
+void UEquipmentInstance::SetDormant(bool bInDormant)
 {
+	bDormant = bInDormant;
+
+	// the owning client hides its copies too, a predicted weapon switch shows before the replicated hidden flag arrives
 	for (AActor* Actor : SpawnedActors)
 	{
 		if (Actor)
 		{
-			Actor->Destroy();
+			Actor->SetActorHiddenInGame(bInDormant);
+		}
+	}
+	for (AActor* Actor : CosmeticActors)
+	{
+		if (Actor)
+		{
+			Actor->SetActorHiddenInGame(bInDormant);
 		}
 	}
 }
 
 void UEquipmentInstance::OnEquipped()
 {
-	USkeletalMeshComponent* mesh = GetPawn()->GetComponentByClass<USkeletalMeshComponent>();
+	const bool bRunCosmetics = ShouldRunCosmetics(this);
+
+	USkeletalMeshComponent* mesh = bRunCosmetics ? GetPawn()->GetComponentByClass<USkeletalMeshComponent>() : nullptr;
 	if (mesh) {
-		if (UInventoryCosmeticComponent* cosmeticComponent = GetPawn()->GetComponentByClass<UInventoryCosmeticComponent>())
-			CosmeticAnimationStyleTags = cosmeticComponent->GetCombinedTags(EquipmentLayerPrefix);
-		if (TSubclassOf<UAnimInstance> EquipmentLayer = EquipmentLayerSet.SelectBestLayer(CosmeticAnimationStyleTags))
-			mesh->LinkAnimClassLayers(EquipmentLayer);
+		static const FCosmeticTagSet NoCosmeticTags;
+		const UInventoryCosmeticComponent* cosmeticComponent = GetPawn()->GetComponentByClass<UInventoryCosmeticComponent>();
+		const FCosmeticTagSet& CosmeticTags = cosmeticComponent ? cosmeticComponent->GetFilteredTags(EquipmentLayerPrefix) : NoCosmeticTags;
+		CosmeticAnimationStyleTags = CosmeticTags.Tags;
+		LinkedEquipmentLayer = SelectEquipmentLayer(CosmeticTags);
+		if (LinkedEquipmentLayer)
+			mesh->LinkAnimClassLayers(LinkedEquipmentLayer);
 		if (UAnimInstance* animInstance = mesh->GetAnimInstance())
-			animInstance->Montage_Play(EquipMontage);
+			animInstance->Montage_Play(FEquipmentPreloadStats::Resolve(EquipMontage));
 	}
 
+	if (bRunCosmetics)
+		SpawnCosmeticActors();
+
 	K2_OnEquipped();
 
 	UWorld* World = GetWorld();
 	check(World);
 	TimeLastEquipped = World->GetTimeSeconds();
+
+	if (WantsTick())
+	{
+		if (UEquipmentTickSubsystem* TickSubsystem = World->GetSubsystem<UEquipmentTickSubsystem>())
+		{
+			TickSubsystem->RegisterInstance(this);
+		}
+	}
 }
 
 void UEquipmentInstance::OnUnequipped()
 {
-	USkeletalMeshComponent* mesh = GetPawn()->GetComponentByClass<USkeletalMeshComponent>();
+	USkeletalMeshComponent* mesh = ShouldRunCosmetics(this) ? GetPawn()->GetComponentByClass<USkeletalMeshComponent>() : nullptr;
 	if (mesh) {
-		if (TSubclassOf<UAnimInstance> EquipmentLayer = EquipmentLayerSet.SelectBestLayer(CosmeticAnimationStyleTags))
-			mesh->UnlinkAnimClassLayers(EquipmentLayer);
+		if (LinkedEquipmentLayer)
+			mesh->UnlinkAnimClassLayers(LinkedEquipmentLayer);
+		LinkedEquipmentLayer = nullptr;
 		if (UAnimInstance* animInstance = mesh->GetAnimInstance())
-			animInstance->Montage_Play(UnequipMontage);
+			animInstance->Montage_Play(FEquipmentPreloadStats::Resolve(UnequipMontage));
 	}
 
+	DestroyCosmeticActors();
+
 	K2_OnUnequipped();
+
+	if (bTickRegistered)
+	{
+		if (UEquipmentTickSubsystem* TickSubsystem = UWorld::GetSubsystem<UEquipmentTickSubsystem>(GetWorld()))
+		{
+			TickSubsystem->UnregisterInstance(this);
+		}
+	}
+}
+
+TSubclassOf<UAnimInstance> UEquipmentInstance::SelectEquipmentLayer(const FCosmeticTagSet& CosmeticTags) const
+{
+	// the rules are class defaults, so every instance of the class picks the same rule for the same tags
+	const UEquipmentInstance* CDO = GetClass()->GetDefaultObject<UEquipmentInstance>();
+
+	if (const FLayerSelectionMemo* Memo = CDO->LayerSelectionMemo.Find(CosmeticTags.Hash))
+	{
+		if (Memo->Tags == CosmeticTags.Tags)
+			return EquipmentLayerSet.GetRuleLayer(Memo->RuleIndex);
+	}
+
+	FLayerSelectionMemo& Memo = CDO->LayerSelectionMemo.Add(CosmeticTags.Hash);
+	Memo.Tags = CosmeticTags.Tags;
+	Memo.RuleIndex = EquipmentLayerSet.SelectBestRule(CosmeticTags.Tags);
+	return EquipmentLayerSet.GetRuleLayer(Memo.RuleIndex);
+}
+
+void UEquipmentInstance::GatherAssetsToLoad(TArray<FSoftObjectPath>& OutAssets) const
+{
+	// montages and layers are never played on a dedicated server that strips cosmetics
+	if (!ShouldRunCosmetics(nullptr))
+		return;
+
+	if (!EquipMontage.IsNull())
+		OutAssets.AddUnique(EquipMontage.ToSoftObjectPath());
+	if (!UnequipMontage.IsNull())
+		OutAssets.AddUnique(UnequipMontage.ToSoftObjectPath());
+
+	EquipmentLayerSet.GatherAssetsToLoad(OutAssets);
 }
 
 void UEquipmentInstance::UpdateUseTime()
@@ -119,15 +313,60 @@ void UEquipmentInstance::OnRep_Instigator()
 {
 }
 
+void UEquipmentInstance::OnRep_SpawnedActors()
+{
+	OnEquipmentActorsChanged();
+}
+
 TSubclassOf<UAnimInstance> FInventoryAnimLayerSelectionSet::SelectBestLayer(const FGameplayTagContainer& CosmeticTags) const
 {
-	for (const FInventoryAnimLayerSelectionEntry& Rule : LayerRules)
+	return GetRuleLayer(SelectBestRule(CosmeticTags));
+}
+
+int32 FInventoryAnimLayerSelectionSet::SelectBestRule(const FGameplayTagContainer& CosmeticTags) const
+{
+	for (int32 RuleIndex = 0; RuleIndex < LayerRules.Num(); ++RuleIndex)
 	{
-		if ((Rule.Layer != nullptr) && CosmeticTags.HasAll(Rule.RequiredTags))
+		const FInventoryAnimLayerSelectionEntry& Rule = LayerRules[RuleIndex];
+		if (!Rule.Layer.IsNull() && CosmeticTags.HasAll(Rule.RequiredTags))
 		{
-			return Rule.Layer;
+			return RuleIndex;
 		}
 	}
 
-	return DefaultLayer;
+	return INDEX_NONE;
 }
+
+TSubclassOf<UAnimInstance> FInventoryAnimLayerSelectionSet::GetRuleLayer(int32 RuleIndex) const
+{
+	return FEquipmentPreloadStats::Resolve(LayerRules.IsValidIndex(RuleIndex) ? LayerRules[RuleIndex].Layer : DefaultLayer);
+}
+
+void FInventoryAnimLayerSelectionSet::GatherAssetsToLoad(TArray<FSoftObjectPath>& OutAssets) const
+{
+	for (const FInventoryAnimLayerSelectionEntry& Rule : LayerRules)
+	{
+		if (!Rule.Layer.IsNull())
+			OutAssets.AddUnique(Rule.Layer.ToSoftObjectPath());
+	}
+	if (!DefaultLayer.IsNull())
+		OutAssets.AddUnique(DefaultLayer.ToSoftObjectPath());
+}
+
+FEquipmentPreloadStats& FEquipmentPreloadStats::Get()
+{
+	static FEquipmentPreloadStats Stats;
+	return Stats;
+}
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommand DumpEquipmentPreloadStatsCommand(
+	TEXT("Equipment.PreloadStats"),
+	TEXT("Logs how often equips found their assets preloaded, waited for them or loaded them synchronously"),
+	FConsoleCommandDelegate::CreateLambda([]()
+		{
+			const FEquipmentPreloadStats& Stats = FEquipmentPreloadStats::Get();
+			UE_LOG(LogInventoryAbilitySystem, Display, TEXT("Equipment preload: %d preloads started, %d equips resident, %d equips deferred, %d synchronous loads"),
+				Stats.NumPreloadsStarted, Stats.NumEquipsResident, Stats.NumEquipsDeferred, Stats.NumSyncLoads);
+		}));
+#endif
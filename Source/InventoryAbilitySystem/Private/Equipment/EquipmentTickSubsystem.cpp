@@ -0,0 +1,62 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Equipment/EquipmentTickSubsystem.h"
+#include "Equipment/EquipmentInstance.h"
+
+void UEquipmentTickSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	RangedWeaponSimulation.Step(GetWorld(), DeltaTime);
+
+	// instances unregistered by a tick are only cleared, so the others keep their index and tick once
+	bTickingInstances = true;
+	for (int32 Index = ActiveInstances.Num() - 1; Index >= 0; --Index)
+	{
+		if (!ActiveInstances.IsValidIndex(Index))
+			continue;
+
+		UEquipmentInstance* Instance = ActiveInstances[Index];
+		if (IsValid(Instance))
+			Instance->Tick(DeltaTime);
+	}
+	bTickingInstances = false;
+
+	ActiveInstances.RemoveAllSwap([](const UEquipmentInstance* Instance) { return !IsValid(Instance); }, EAllowShrinking::No);
+}
+
+TStatId UEquipmentTickSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UEquipmentTickSubsystem, STATGROUP_Tickables);
+}
+
+void UEquipmentTickSubsystem::RegisterInstance(UEquipmentInstance* Instance)
+{
+	check(Instance);
+
+	if (!Instance->bTickRegistered)
+	{
+		Instance->bTickRegistered = true;
+		ActiveInstances.Add(Instance);
+	}
+}
+
+void UEquipmentTickSubsystem::UnregisterInstance(UEquipmentInstance* Instance)
+{
+	check(Instance);
+
+	if (Instance->bTickRegistered)
+	{
+		if (bTickingInstances)
+		{
+			const int32 Index = ActiveInstances.Find(Instance);
+			if (Index != INDEX_NONE)
+				ActiveInstances[Index] = nullptr;
+		}
+		else
+			ActiveInstances.RemoveSingleSwap(Instance, EAllowShrinking::No);
+	}
+
+	Instance->bTickRegistered = false;
+}
@@ -0,0 +1,294 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Equipment/ProjectileSubsystem.h"
+#include "Equipment/WeaponInstance.h"
+#include "Ability/InventoryAbilitySystemComponent.h"
+#include "Ability/WeaponHitQueueSubsystem.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Engine/World.h"
+#include "GameplayEffect.h"
+#include "HAL/IConsoleManager.h"
+
+void UProjectileSubsystem::Deinitialize()
+{
+	if (VisualsActor)
+	{
+		VisualsActor->Destroy();
+		VisualsActor = nullptr;
+	}
+
+	Super::Deinitialize();
+}
+
+void UProjectileSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (GetNumProjectiles() == 0 && !VisualsActor)
+		return;
+
+	// the segments swept last frame are checked before the projectiles move on
+	TArray<FProjectileHit> Hits;
+	CollectSweepResults(Hits);
+
+	Integrate(DeltaTime);
+	StartSweeps();
+
+	// hits are applied once the arrays are consistent again, a damage effect may spawn more projectiles
+	for (const FProjectileHit& Hit : Hits)
+	{
+		ApplyHit(Hit);
+	}
+
+	UpdateVisuals();
+}
+
+TStatId UProjectileSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UProjectileSubsystem, STATGROUP_Tickables);
+}
+
+void UProjectileSubsystem::SpawnProjectile(const UProjectileDefinition* Definition, const FVector& Location, const FVector& Direction, UWeaponInstance* Weapon, UAbilitySystemComponent* SourceAbilitySystem)
+{
+	if (!Definition)
+		return;
+
+	const int32 Type = FindOrAddType(Definition);
+	const FVector Velocity = Direction.GetSafeNormal() * Definition->Speed;
+
+	PositionX.Add(Location.X);
+	PositionY.Add(Location.Y);
+	PositionZ.Add(Location.Z);
+	PreviousX.Add(Location.X);
+	PreviousY.Add(Location.Y);
+	PreviousZ.Add(Location.Z);
+	VelocityX.Add(Velocity.X);
+	VelocityY.Add(Velocity.Y);
+	VelocityZ.Add(Velocity.Z);
+	GravityZ.Add(GetWorld()->GetGravityZ() * Definition->GravityScale);
+	RemainingLifetime.Add(Definition->Lifetime);
+
+	const URangedWeaponInstance* RangedWeapon = Cast<URangedWeaponInstance>(Weapon);
+	Origins.Add(Location);
+	TypeIndices.Add((uint16)Type);
+	TraceChannels.Add(RangedWeapon ? RangedWeapon->GetTraceChannel() : ECC_Visibility);
+	Authoritative.Add(SourceAbilitySystem && SourceAbilitySystem->IsOwnerActorAuthoritative() ? 1 : 0);
+	Weapons.Add(Weapon);
+	Sources.Add(SourceAbilitySystem);
+}
+
+int32 UProjectileSubsystem::FindOrAddType(const UProjectileDefinition* Definition)
+{
+	const int32 Index = Types.IndexOfByPredicate([Definition](const FProjectileType& Type) { return Type.Definition == Definition; });
+	if (Index != INDEX_NONE)
+		return Index;
+
+	check(Types.Num() < MAX_uint16);
+	FProjectileType& Type = Types.AddDefaulted_GetRef();
+	Type.Definition = Definition;
+	return Types.Num() - 1;
+}
+
+void UProjectileSubsystem::Integrate(float DeltaSeconds)
+{
+	const int32 Num = GetNumProjectiles();
+
+	// Semi-implicit Euler, four projectiles at a time
+	const VectorRegister4Double DeltaTime = VectorSetDouble1(DeltaSeconds);
+	int32 Index = 0;
+	for (; Index + 4 <= Num; Index += 4)
+	{
+		const VectorRegister4Double X = VectorLoad(&PositionX[Index]);
+		const VectorRegister4Double Y = VectorLoad(&PositionY[Index]);
+		const VectorRegister4Double Z = VectorLoad(&PositionZ[Index]);
+		VectorStore(X, &PreviousX[Index]);
+		VectorStore(Y, &PreviousY[Index]);
+		VectorStore(Z, &PreviousZ[Index]);
+
+		const VectorRegister4Double VelZ = VectorMultiplyAdd(VectorLoad(&GravityZ[Index]), DeltaTime, VectorLoad(&VelocityZ[Index]));
+		VectorStore(VelZ, &VelocityZ[Index]);
+
+		VectorStore(VectorMultiplyAdd(VectorLoad(&VelocityX[Index]), DeltaTime, X), &PositionX[Index]);
+		VectorStore(VectorMultiplyAdd(VectorLoad(&VelocityY[Index]), DeltaTime, Y), &PositionY[Index]);
+		VectorStore(VectorMultiplyAdd(VelZ, DeltaTime, Z), &PositionZ[Index]);
+		VectorStore(VectorSubtract(VectorLoad(&RemainingLifetime[Index]), DeltaTime), &RemainingLifetime[Index]);
+	}
+	for (; Index < Num; ++Index)
+	{
+		PreviousX[Index] = PositionX[Index];
+		PreviousY[Index] = PositionY[Index];
+		PreviousZ[Index] = PositionZ[Index];
+		VelocityZ[Index] += GravityZ[Index] * DeltaSeconds;
+		PositionX[Index] += VelocityX[Index] * DeltaSeconds;
+		PositionY[Index] += VelocityY[Index] * DeltaSeconds;
+		PositionZ[Index] += VelocityZ[Index] * DeltaSeconds;
+		RemainingLifetime[Index] -= DeltaSeconds;
+	}
+}
+
+void UProjectileSubsystem::CollectSweepResults(TArray<FProjectileHit>& OutHits)
+{
+	UWorld* World = GetWorld();
+
+	// backwards, removing swaps the last projectile in
+	FTraceDatum Datum;
+	for (int32 Index = GetNumProjectiles() - 1; Index >= 0; --Index)
+	{
+		const FHitResult* Hit = nullptr;
+		if (SweepHandles.IsValidIndex(Index) && World->QueryTraceData(SweepHandles[Index], Datum) && Datum.UserData == SweepBatch)
+			Hit = Datum.OutHits.FindByPredicate([](const FHitResult& Result) { return Result.bBlockingHit; });
+
+		if (Hit)
+		{
+			if (Authoritative[Index])
+			{
+				// measured from the muzzle, the distance falloff sees the whole flight
+				FHitResult NewHit = *Hit;
+				NewHit.TraceStart = Origins[Index];
+				OutHits.Add({ NewHit, Origins[Index], TypeIndices[Index], Weapons[Index], Sources[Index] });
+			}
+			RemoveAtSwap(Index);
+		}
+		else if (RemainingLifetime[Index] <= 0.0)
+		{
+			RemoveAtSwap(Index);
+		}
+	}
+	SweepHandles.Reset();
+}
+
+void UProjectileSubsystem::StartSweeps()
+{
+	UWorld* World = GetWorld();
+
+	// one set of params for the whole batch, only the ignored instigator changes between projectiles
+	FCollisionQueryParams Params(SCENE_QUERY_STAT(ProjectileSweep), /*bTraceComplex=*/ true);
+	Params.bReturnPhysicalMaterial = true;
+
+	++SweepBatch;
+	SweepHandles.SetNum(GetNumProjectiles());
+	for (int32 Index = 0; Index < GetNumProjectiles(); ++Index)
+	{
+		const FVector Start(PreviousX[Index], PreviousY[Index], PreviousZ[Index]);
+		const FVector End(PositionX[Index], PositionY[Index], PositionZ[Index]);
+		const UProjectileDefinition* Definition = Types[TypeIndices[Index]].Definition;
+
+		Params.ClearIgnoredSourceObjects();
+		if (const UAbilitySystemComponent* Source = Sources[Index].Get())
+			Params.AddIgnoredActor(Source->GetAvatarActor_Direct());
+
+		SweepHandles[Index] = Definition->Radius > 0.0f
+			? World->AsyncSweepByChannel(EAsyncTraceType::Single, Start, End, FQuat::Identity, TraceChannels[Index], FCollisionShape::MakeSphere(Definition->Radius), Params, FCollisionResponseParams::DefaultResponseParam, nullptr, SweepBatch)
+			: World->AsyncLineTraceByChannel(EAsyncTraceType::Single, Start, End, TraceChannels[Index], Params, FCollisionResponseParams::DefaultResponseParam, nullptr, SweepBatch);
+	}
+}
+
+void UProjectileSubsystem::ApplyHit(const FProjectileHit& Hit) const
+{
+	// queued with the hitscan hits, projectiles of a frame on the same target are applied as one effect
+	if (UWeaponHitQueueSubsystem* HitQueue = UWorld::GetSubsystem<UWeaponHitQueueSubsystem>(GetWorld()))
+		HitQueue->QueueHit(Hit.Source.Get(), nullptr, Hit.Weapon.Get(), Types[Hit.Type].Definition->DamageEffect, 1.0f, Hit.Hit);
+}
+
+void UProjectileSubsystem::UpdateVisuals()
+{
+	if (!UEquipmentInstance::ShouldRunCosmetics(GetWorld()))
+		return;
+
+	if (!VisualsActor)
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.ObjectFlags |= RF_Transient;
+		VisualsActor = GetWorld()->SpawnActor<AActor>(SpawnParams);
+		if (!VisualsActor)
+			return;
+		VisualsActor->SetRootComponent(NewObject<USceneComponent>(VisualsActor));
+		VisualsActor->GetRootComponent()->RegisterComponent();
+	}
+
+	for (FProjectileType& Type : Types)
+	{
+		Type.InstanceTransforms.Reset();
+		if (!Type.Visuals && Type.Definition->Mesh)
+		{
+			Type.Visuals = NewObject<UInstancedStaticMeshComponent>(VisualsActor);
+			Type.Visuals->SetStaticMesh(Type.Definition->Mesh);
+			Type.Visuals->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+			Type.Visuals->SetMobility(EComponentMobility::Movable);
+			Type.Visuals->SetupAttachment(VisualsActor->GetRootComponent());
+			Type.Visuals->RegisterComponent();
+		}
+	}
+
+	for (int32 Index = 0; Index < GetNumProjectiles(); ++Index)
+	{
+		FProjectileType& Type = Types[TypeIndices[Index]];
+		if (!Type.Visuals)
+			continue;
+
+		const FVector Velocity(VelocityX[Index], VelocityY[Index], VelocityZ[Index]);
+		Type.InstanceTransforms.Emplace(Velocity.Rotation(), FVector(PositionX[Index], PositionY[Index], PositionZ[Index]), Type.Definition->MeshScale);
+	}
+
+	// instances are reused from frame to frame, only the surplus is added or removed
+	for (FProjectileType& Type : Types)
+	{
+		if (!Type.Visuals)
+			continue;
+
+		const int32 NumWanted = Type.InstanceTransforms.Num();
+		const int32 NumInstances = Type.Visuals->GetInstanceCount();
+		if (NumInstances > NumWanted)
+		{
+			TArray<int32> Surplus;
+			for (int32 Instance = NumInstances - 1; Instance >= NumWanted; --Instance)
+			{
+				Surplus.Add(Instance);
+			}
+			Type.Visuals->RemoveInstances(Surplus);
+		}
+		else if (NumInstances < NumWanted)
+		{
+			TArray<FTransform> Added(&Type.InstanceTransforms[NumInstances], NumWanted - NumInstances);
+			Type.Visuals->AddInstances(Added, /*bShouldReturnIndices=*/ false, /*bWorldSpace=*/ true);
+		}
+
+		if (NumWanted > 0)
+			Type.Visuals->BatchUpdateInstancesTransforms(0, Type.InstanceTransforms, /*bWorldSpace=*/ true, /*bMarkRenderStateDirty=*/ true);
+	}
+}
+
+void UProjectileSubsystem::RemoveAtSwap(int32 Index)
+{
+	PositionX.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	PositionY.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	PositionZ.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	PreviousX.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	PreviousY.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	PreviousZ.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	VelocityX.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	VelocityY.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	VelocityZ.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	GravityZ.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	RemainingLifetime.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	Origins.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	TypeIndices.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	TraceChannels.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	Authoritative.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	Weapons.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	Sources.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+}
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommandWithWorld DumpProjectileStatsCommand(
+	TEXT("Projectiles.Stats"),
+	TEXT("Logs the number of simulated projectiles"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+		{
+			if (const UProjectileSubsystem* Subsystem = UWorld::GetSubsystem<UProjectileSubsystem>(World))
+			{
+				UE_LOG(LogInventoryAbilitySystem, Display, TEXT("Projectiles: %d simulated"), Subsystem->GetNumProjectiles());
+			}
+		}));
+#endif
@@ -0,0 +1,477 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Equipment/RangedWeaponSimulation.h"
+#include "Equipment/BakedFloatCurve.h"
+#include "Equipment/WeaponInstance.h"
+#include "Ability/InventoryAbilitySystemComponent.h"
+#include "Curves/RichCurve.h"
+#include "HAL/IConsoleManager.h"
+
+namespace RangedWeaponSimulation
+{
+	// Same tolerance the multipliers used when they were updated per weapon
+	static const float MultiplierNearlyEqualThreshold = 0.05f;
+
+	// FMath::FInterpTo for four lanes
+	FORCEINLINE VectorRegister4Float VectorInterpTo(const VectorRegister4Float& Current, const VectorRegister4Float& Target, const VectorRegister4Float& DeltaTime, const VectorRegister4Float& InterpSpeed)
+	{
+		const VectorRegister4Float Zero = VectorZeroFloat();
+		const VectorRegister4Float One = VectorOneFloat();
+
+		// zero or negative speed snaps to the target
+		VectorRegister4Float Alpha = VectorMin(VectorMax(VectorMultiply(DeltaTime, InterpSpeed), Zero), One);
+		Alpha = VectorSelect(VectorCompareLE(InterpSpeed, Zero), One, Alpha);
+
+		const VectorRegister4Float Dist = VectorSubtract(Target, Current);
+		const VectorRegister4Float Result = VectorMultiplyAdd(Dist, Alpha, Current);
+
+		// close enough snaps to the target
+		return VectorSelect(VectorCompareLT(VectorMultiply(Dist, Dist), VectorSetFloat1(UE_SMALL_NUMBER)), Target, Result);
+	}
+}
+
+int32 FRangedWeaponSimulation::Add(URangedWeaponInstance* Owner, const FRangedWeaponSimulationParams& Params)
+{
+	const int32 Index = Owners.Add(Owner);
+
+	Heat.Add(Params.InitialHeat);
+	SpreadAngle.Add(Params.HeatToSpreadCurve->Eval(Params.InitialHeat));
+	StandingStillMultiplier.Add(1.0f);
+	CrouchingMultiplier.Add(1.0f);
+	JumpFallMultiplier.Add(1.0f);
+	CombinedMultiplier.Add(1.0f);
+	Overheated.Add(0);
+
+	MovementState.Add(MovementStateInTransition);
+	CoolingDown.Add(0);
+	CoolDownRate.Add(0.0f);
+	StandingStillTarget.Add(1.0f);
+	CrouchingTarget.Add(1.0f);
+	JumpFallTarget.Add(1.0f);
+	AimingMultiplier.Add(1.0f);
+
+	HeatToSpreadCurve.Add(Params.HeatToSpreadCurve);
+	HeatToCoolDownPerSecondCurve.Add(Params.HeatToCoolDownPerSecondCurve);
+	MinHeat.Add(Params.MinHeat);
+	MaxHeat.Add(Params.MaxHeat);
+	MinSpread.Add(Params.MinSpread);
+	TransitionRate_StandingStill.Add(Params.TransitionRate_StandingStill);
+	TransitionRate_Crouching.Add(Params.TransitionRate_Crouching);
+	TransitionRate_JumpingOrFalling.Add(Params.TransitionRate_JumpingOrFalling);
+	CanOverheat.Add(Params.bCanOverheat ? 1 : 0);
+
+	if (Owner)
+	{
+		Owner->SimulationIndex = Index;
+	}
+
+	// new weapons start awake
+	Wake(Index);
+	return NumAwake - 1;
+}
+
+void FRangedWeaponSimulation::Remove(int32 Index)
+{
+	check(Owners.IsValidIndex(Index));
+
+	if (Index < NumAwake)
+	{
+		Swap(Index, NumAwake - 1);
+		Index = NumAwake - 1;
+		--NumAwake;
+	}
+
+	Swap(Index, Owners.Num() - 1);
+	RemoveLast();
+}
+
+void FRangedWeaponSimulation::Wake(int32 Index)
+{
+	check(Owners.IsValidIndex(Index));
+
+	if (Index >= NumAwake)
+	{
+		Swap(Index, NumAwake);
+		++NumAwake;
+	}
+}
+
+void FRangedWeaponSimulation::Step(UWorld* World, float DeltaSeconds)
+{
+	for (int32 Index = Owners.Num() - 1; Index >= 0; --Index)
+	{
+		URangedWeaponInstance* Owner = Owners[Index].Get();
+		if (Owner == nullptr)
+		{
+			Remove(Index);
+			continue;
+		}
+
+		if (Owner->GetPawn() == nullptr)
+		{
+			continue;
+		}
+
+		const uint8 CurrentMovementState = Owner->GetMovementState();
+		if (Index >= NumAwake)
+		{
+			// sleeping, only look for a movement change
+			if (CurrentMovementState == MovementState[Index])
+			{
+				continue;
+			}
+			Wake(Index);
+		}
+
+		FRangedWeaponMultiplierTargets Targets;
+		Owner->GatherMultiplierTargets(Targets);
+
+		// waking up moves the weapon to the end of the awake range
+		const int32 AwakeIndex = Owner->SimulationIndex;
+		MovementState[AwakeIndex] = CurrentMovementState;
+		CoolingDown[AwakeIndex] = World->TimeSince(Owner->GetTimeLastUsed()) > Owner->SpreadRecoveryCooldownDelay ? 1 : 0;
+		StandingStillTarget[AwakeIndex] = Targets.StandingStill;
+		CrouchingTarget[AwakeIndex] = Targets.Crouching;
+		JumpFallTarget[AwakeIndex] = Targets.JumpingOrFalling;
+		AimingMultiplier[AwakeIndex] = Targets.Aiming;
+	}
+
+	Simulate(DeltaSeconds);
+}
+
+void FRangedWeaponSimulation::Simulate(float DeltaSeconds)
+{
+	using namespace RangedWeaponSimulation;
+
+	// Sample the cooldown curves, weapons still inside their recovery delay don't cool down
+	for (int32 Index = 0; Index < NumAwake; ++Index)
+	{
+		CoolDownRate[Index] = CoolingDown[Index] ? HeatToCoolDownPerSecondCurve[Index]->Eval(Heat[Index]) : 0.0f;
+	}
+
+	// Heat cooldown and multiplier interpolation, four weapons at a time
+	const VectorRegister4Float DeltaTime = VectorSetFloat1(DeltaSeconds);
+	int32 Index = 0;
+	for (; Index + 4 <= NumAwake; Index += 4)
+	{
+		VectorRegister4Float NewHeat = VectorNegateMultiplyAdd(VectorLoad(&CoolDownRate[Index]), DeltaTime, VectorLoad(&Heat[Index]));
+		NewHeat = VectorMin(VectorMax(NewHeat, VectorLoad(&MinHeat[Index])), VectorLoad(&MaxHeat[Index]));
+		VectorStore(NewHeat, &Heat[Index]);
+
+		const VectorRegister4Float StandingStill = VectorInterpTo(VectorLoad(&StandingStillMultiplier[Index]), VectorLoad(&StandingStillTarget[Index]), DeltaTime, VectorLoad(&TransitionRate_StandingStill[Index]));
+		const VectorRegister4Float Crouching = VectorInterpTo(VectorLoad(&CrouchingMultiplier[Index]), VectorLoad(&CrouchingTarget[Index]), DeltaTime, VectorLoad(&TransitionRate_Crouching[Index]));
+		const VectorRegister4Float JumpFall = VectorInterpTo(VectorLoad(&JumpFallMultiplier[Index]), VectorLoad(&JumpFallTarget[Index]), DeltaTime, VectorLoad(&TransitionRate_JumpingOrFalling[Index]));
+		VectorStore(StandingStill, &StandingStillMultiplier[Index]);
+		VectorStore(Crouching, &CrouchingMultiplier[Index]);
+		VectorStore(JumpFall, &JumpFallMultiplier[Index]);
+
+		const VectorRegister4Float Combined = VectorMultiply(VectorMultiply(StandingStill, Crouching), VectorMultiply(JumpFall, VectorLoad(&AimingMultiplier[Index])));
+		VectorStore(Combined, &CombinedMultiplier[Index]);
+	}
+	for (; Index < NumAwake; ++Index)
+	{
+		Heat[Index] = FMath::Clamp(Heat[Index] - CoolDownRate[Index] * DeltaSeconds, MinHeat[Index], MaxHeat[Index]);
+		StandingStillMultiplier[Index] = FMath::FInterpTo(StandingStillMultiplier[Index], StandingStillTarget[Index], DeltaSeconds, TransitionRate_StandingStill[Index]);
+		CrouchingMultiplier[Index] = FMath::FInterpTo(CrouchingMultiplier[Index], CrouchingTarget[Index], DeltaSeconds, TransitionRate_Crouching[Index]);
+		JumpFallMultiplier[Index] = FMath::FInterpTo(JumpFallMultiplier[Index], JumpFallTarget[Index], DeltaSeconds, TransitionRate_JumpingOrFalling[Index]);
+		CombinedMultiplier[Index] = StandingStillMultiplier[Index] * CrouchingMultiplier[Index] * JumpFallMultiplier[Index] * AimingMultiplier[Index];
+	}
+
+	// Map the heat to the spread and put weapons at rest to sleep
+	for (Index = NumAwake - 1; Index >= 0; --Index)
+	{
+		ClampHeat(Index);
+		SpreadAngle[Index] = HeatToSpreadCurve[Index]->Eval(Heat[Index]);
+
+		const bool bAtRest = MovementState[Index] != MovementStateInTransition
+			&& FMath::IsNearlyEqual(Heat[Index], MinHeat[Index], KINDA_SMALL_NUMBER)
+			&& FMath::IsNearlyEqual(SpreadAngle[Index], MinSpread[Index], KINDA_SMALL_NUMBER)
+			&& FMath::IsNearlyEqual(StandingStillMultiplier[Index], StandingStillTarget[Index], MultiplierNearlyEqualThreshold)
+			&& FMath::IsNearlyEqual(CrouchingMultiplier[Index], CrouchingTarget[Index], MultiplierNearlyEqualThreshold)
+			&& FMath::IsNearlyEqual(JumpFallMultiplier[Index], JumpFallTarget[Index], MultiplierNearlyEqualThreshold);
+		if (bAtRest)
+		{
+			Swap(Index, NumAwake - 1);
+			--NumAwake;
+		}
+	}
+}
+
+void FRangedWeaponSimulation::AddHeat(int32 Index, float HeatPerShot)
+{
+	check(Owners.IsValidIndex(Index));
+
+	Heat[Index] += HeatPerShot;
+	ClampHeat(Index);
+	SpreadAngle[Index] = HeatToSpreadCurve[Index]->Eval(Heat[Index]);
+
+	Wake(Index);
+}
+
+void FRangedWeaponSimulation::SetInputs(int32 Index, const FRangedWeaponMultiplierTargets& Targets, bool bCoolingDown)
+{
+	check(Owners.IsValidIndex(Index));
+
+	MovementState[Index] = MovementStateInTransition;
+	CoolingDown[Index] = bCoolingDown ? 1 : 0;
+	StandingStillTarget[Index] = Targets.StandingStill;
+	CrouchingTarget[Index] = Targets.Crouching;
+	JumpFallTarget[Index] = Targets.JumpingOrFalling;
+	AimingMultiplier[Index] = Targets.Aiming;
+}
+
+void FRangedWeaponSimulation::ClampHeat(int32 Index)
+{
+	if (CanOverheat[Index])
+	{
+		if (Overheated[Index])
+		{
+			Overheated[Index] = Heat[Index] <= MinHeat[Index] ? 1 : 0;
+		}
+		else
+		{
+			Overheated[Index] = Heat[Index] >= MaxHeat[Index] ? 1 : 0;
+		}
+	}
+
+	Heat[Index] = FMath::Clamp(Heat[Index], MinHeat[Index], MaxHeat[Index]);
+}
+
+void FRangedWeaponSimulation::Swap(int32 A, int32 B)
+{
+	if (A == B)
+	{
+		return;
+	}
+
+	Owners.Swap(A, B);
+	Heat.Swap(A, B);
+	SpreadAngle.Swap(A, B);
+	StandingStillMultiplier.Swap(A, B);
+	CrouchingMultiplier.Swap(A, B);
+	JumpFallMultiplier.Swap(A, B);
+	CombinedMultiplier.Swap(A, B);
+	Overheated.Swap(A, B);
+
+	MovementState.Swap(A, B);
+	CoolingDown.Swap(A, B);
+	CoolDownRate.Swap(A, B);
+	StandingStillTarget.Swap(A, B);
+	CrouchingTarget.Swap(A, B);
+	JumpFallTarget.Swap(A, B);
+	AimingMultiplier.Swap(A, B);
+
+	HeatToSpreadCurve.Swap(A, B);
+	HeatToCoolDownPerSecondCurve.Swap(A, B);
+	MinHeat.Swap(A, B);
+	MaxHeat.Swap(A, B);
+	MinSpread.Swap(A, B);
+	TransitionRate_StandingStill.Swap(A, B);
+	TransitionRate_Crouching.Swap(A, B);
+	TransitionRate_JumpingOrFalling.Swap(A, B);
+	CanOverheat.Swap(A, B);
+
+	if (URangedWeaponInstance* OwnerA = Owners[A].Get())
+	{
+		OwnerA->SimulationIndex = A;
+	}
+	if (URangedWeaponInstance* OwnerB = Owners[B].Get())
+	{
+		OwnerB->SimulationIndex = B;
+	}
+}
+
+void FRangedWeaponSimulation::RemoveLast()
+{
+	if (URangedWeaponInstance* Owner = Owners.Last().Get())
+	{
+		Owner->SimulationIndex = INDEX_NONE;
+	}
+
+	Owners.Pop(EAllowShrinking::No);
+	Heat.Pop(EAllowShrinking::No);
+	SpreadAngle.Pop(EAllowShrinking::No);
+	StandingStillMultiplier.Pop(EAllowShrinking::No);
+	CrouchingMultiplier.Pop(EAllowShrinking::No);
+	JumpFallMultiplier.Pop(EAllowShrinking::No);
+	CombinedMultiplier.Pop(EAllowShrinking::No);
+	Overheated.Pop(EAllowShrinking::No);
+
+	MovementState.Pop(EAllowShrinking::No);
+	CoolingDown.Pop(EAllowShrinking::No);
+	CoolDownRate.Pop(EAllowShrinking::No);
+	StandingStillTarget.Pop(EAllowShrinking::No);
+	CrouchingTarget.Pop(EAllowShrinking::No);
+	JumpFallTarget.Pop(EAllowShrinking::No);
+	AimingMultiplier.Pop(EAllowShrinking::No);
+
+	HeatToSpreadCurve.Pop(EAllowShrinking::No);
+	HeatToCoolDownPerSecondCurve.Pop(EAllowShrinking::No);
+	MinHeat.Pop(EAllowShrinking::No);
+	MaxHeat.Pop(EAllowShrinking::No);
+	MinSpread.Pop(EAllowShrinking::No);
+	TransitionRate_StandingStill.Pop(EAllowShrinking::No);
+	TransitionRate_Crouching.Pop(EAllowShrinking::No);
+	TransitionRate_JumpingOrFalling.Pop(EAllowShrinking::No);
+	CanOverheat.Pop(EAllowShrinking::No);
+}
+
+#if !UE_BUILD_SHIPPING
+namespace RangedWeaponSimulation
+{
+	// Weapon state laid out like the members of URangedWeaponInstance, one allocation per weapon.
+	// Run with FRichCurve like the weapons did, and with FBakedFloatCurve to tell the layout from the curve lookup
+	template<typename CurveType>
+	struct TLegacyWeaponState
+	{
+		bool bWasOverheated = false;
+		float CurrentHeat = 0.0f;
+		float CurrentSpreadAngle = 0.0f;
+		float CurrentSpreadAngleMultiplier = 1.0f;
+		float StandingStillMultiplier = 1.0f;
+		float JumpFallMultiplier = 1.0f;
+		float CrouchingMultiplier = 1.0f;
+		CurveType HeatToSpreadCurve;
+		CurveType HeatToHeatPerShotCurve;
+		CurveType HeatToCoolDownPerSecondCurve;
+		FRangedWeaponMultiplierTargets Targets;
+	};
+
+	// The per weapon update as URangedWeaponInstance::Tick did it
+	template<typename CurveType>
+	static void TickLegacyWeapon(TLegacyWeaponState<CurveType>& Weapon, float DeltaSeconds)
+	{
+		float Min1, Max1, Min2, Max2, Min3, Max3;
+		Weapon.HeatToHeatPerShotCurve.GetTimeRange(Min1, Max1);
+		Weapon.HeatToCoolDownPerSecondCurve.GetTimeRange(Min2, Max2);
+		Weapon.HeatToSpreadCurve.GetTimeRange(Min3, Max3);
+		const float MinHeat = FMath::Min(FMath::Min(Min1, Min2), Min3);
+		const float MaxHeat = FMath::Max(FMath::Max(Max1, Max2), Max3);
+
+		const float CooldownRate = Weapon.HeatToCoolDownPerSecondCurve.Eval(Weapon.CurrentHeat);
+		Weapon.CurrentHeat = FMath::Clamp(Weapon.CurrentHeat - CooldownRate * DeltaSeconds, MinHeat, MaxHeat);
+		Weapon.CurrentSpreadAngle = Weapon.HeatToSpreadCurve.Eval(Weapon.CurrentHeat);
+
+		Weapon.StandingStillMultiplier = FMath::FInterpTo(Weapon.StandingStillMultiplier, Weapon.Targets.StandingStill, DeltaSeconds, 5.0f);
+		Weapon.CrouchingMultiplier = FMath::FInterpTo(Weapon.CrouchingMultiplier, Weapon.Targets.Crouching, DeltaSeconds, 5.0f);
+		Weapon.JumpFallMultiplier = FMath::FInterpTo(Weapon.JumpFallMultiplier, Weapon.Targets.JumpingOrFalling, DeltaSeconds, 5.0f);
+		Weapon.CurrentSpreadAngleMultiplier = Weapon.StandingStillMultiplier * Weapon.CrouchingMultiplier * Weapon.JumpFallMultiplier * Weapon.Targets.Aiming;
+	}
+
+	static void InitBenchmarkCurves(FRichCurve& HeatToSpread, FRichCurve& HeatToHeatPerShot, FRichCurve& HeatToCoolDown)
+	{
+		HeatToSpread.AddKey(0.0f, 1.0f);
+		HeatToSpread.AddKey(5.0f, 3.0f);
+		HeatToSpread.AddKey(10.0f, 8.0f);
+		HeatToHeatPerShot.AddKey(0.0f, 1.0f);
+		HeatToCoolDown.AddKey(0.0f, 2.0f);
+		HeatToCoolDown.AddKey(10.0f, 1.0f);
+	}
+
+	static void RunBenchmark(const TArray<FString>& Args)
+	{
+		const int32 NumWeapons = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 300;
+		const int32 NumFrames = Args.Num() > 1 ? FMath::Max(1, FCString::Atoi(*Args[1])) : 1000;
+		const float DeltaSeconds = 1.0f / 30.0f;
+
+		FRandomStream Random(NumWeapons);
+		TArray<FRangedWeaponMultiplierTargets> Targets;
+		TArray<float> InitialHeat;
+		for (int32 Index = 0; Index < NumWeapons; ++Index)
+		{
+			FRangedWeaponMultiplierTargets& WeaponTargets = Targets.AddDefaulted_GetRef();
+			WeaponTargets.StandingStill = Random.FRandRange(0.5f, 1.0f);
+			WeaponTargets.Crouching = Random.FRandRange(0.5f, 1.0f);
+			WeaponTargets.JumpingOrFalling = Random.FRandRange(1.0f, 2.0f);
+			InitialHeat.Add(Random.FRandRange(0.0f, 10.0f));
+		}
+
+		FRichCurve HeatToSpread, HeatToHeatPerShot, HeatToCoolDown;
+		InitBenchmarkCurves(HeatToSpread, HeatToHeatPerShot, HeatToCoolDown);
+
+		FBakedFloatCurve BakedHeatToSpread, BakedHeatToHeatPerShot, BakedHeatToCoolDown;
+		BakedHeatToSpread.Bake(HeatToSpread, 256, 0.001f);
+		BakedHeatToHeatPerShot.Bake(HeatToHeatPerShot, 256, 0.001f);
+		BakedHeatToCoolDown.Bake(HeatToCoolDown, 256, 0.001f);
+
+		// Legacy paths, every weapon in its own allocation like the UObjects
+		TArray<TUniquePtr<TLegacyWeaponState<FRichCurve>>> LegacyWeapons;
+		TArray<TUniquePtr<TLegacyWeaponState<FBakedFloatCurve>>> LegacyBakedWeapons;
+		for (int32 Index = 0; Index < NumWeapons; ++Index)
+		{
+			TUniquePtr<TLegacyWeaponState<FRichCurve>>& Weapon = LegacyWeapons.Add_GetRef(MakeUnique<TLegacyWeaponState<FRichCurve>>());
+			InitBenchmarkCurves(Weapon->HeatToSpreadCurve, Weapon->HeatToHeatPerShotCurve, Weapon->HeatToCoolDownPerSecondCurve);
+			Weapon->CurrentHeat = InitialHeat[Index];
+			Weapon->Targets = Targets[Index];
+
+			TUniquePtr<TLegacyWeaponState<FBakedFloatCurve>>& BakedWeapon = LegacyBakedWeapons.Add_GetRef(MakeUnique<TLegacyWeaponState<FBakedFloatCurve>>());
+			BakedWeapon->HeatToSpreadCurve = BakedHeatToSpread;
+			BakedWeapon->HeatToHeatPerShotCurve = BakedHeatToHeatPerShot;
+			BakedWeapon->HeatToCoolDownPerSecondCurve = BakedHeatToCoolDown;
+			BakedWeapon->CurrentHeat = InitialHeat[Index];
+			BakedWeapon->Targets = Targets[Index];
+		}
+
+		// SoA path, weapons kept awake so all paths do the same work
+
+		FRangedWeaponSimulation Simulation;
+		for (int32 Index = 0; Index < NumWeapons; ++Index)
+		{
+			FRangedWeaponSimulationParams Params;
+			Params.HeatToSpreadCurve = &BakedHeatToSpread;
+			Params.HeatToCoolDownPerSecondCurve = &BakedHeatToCoolDown;
+			Params.InitialHeat = InitialHeat[Index];
+			Params.MinHeat = 0.0f;
+			Params.MaxHeat = 10.0f;
+			Params.TransitionRate_StandingStill = 5.0f;
+			Params.TransitionRate_Crouching = 5.0f;
+			Params.TransitionRate_JumpingOrFalling = 5.0f;
+			const int32 SimulationIndex = Simulation.Add(nullptr, Params);
+			Simulation.SetInputs(SimulationIndex, Targets[Index], true);
+		}
+
+		const double LegacyStart = FPlatformTime::Seconds();
+		for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+		{
+			for (const TUniquePtr<TLegacyWeaponState<FRichCurve>>& Weapon : LegacyWeapons)
+			{
+				TickLegacyWeapon(*Weapon, DeltaSeconds);
+			}
+		}
+		const double LegacyTime = FPlatformTime::Seconds() - LegacyStart;
+
+		const double LegacyBakedStart = FPlatformTime::Seconds();
+		for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+		{
+			for (const TUniquePtr<TLegacyWeaponState<FBakedFloatCurve>>& Weapon : LegacyBakedWeapons)
+			{
+				TickLegacyWeapon(*Weapon, DeltaSeconds);
+			}
+		}
+		const double LegacyBakedTime = FPlatformTime::Seconds() - LegacyBakedStart;
+
+		const double SimulationStart = FPlatformTime::Seconds();
+		for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+		{
+			Simulation.Simulate(DeltaSeconds);
+		}
+		const double SimulationTime = FPlatformTime::Seconds() - SimulationStart;
+
+		// the layout factor compares both layouts on baked curves, the curve factor both curve types in the per weapon layout
+		UE_LOG(LogInventoryAbilitySystem, Display, TEXT("Ranged weapon simulation, %d weapons, %d frames: per weapon %.3f ms/frame, per weapon baked %.3f ms/frame, SoA baked %.3f ms/frame (layout %.2fx, baked curves %.2fx, total %.2fx)"),
+			NumWeapons, NumFrames,
+			LegacyTime * 1000.0 / NumFrames,
+			LegacyBakedTime * 1000.0 / NumFrames,
+			SimulationTime * 1000.0 / NumFrames,
+			SimulationTime > 0.0 ? LegacyBakedTime / SimulationTime : 0.0,
+			LegacyBakedTime > 0.0 ? LegacyTime / LegacyBakedTime : 0.0,
+			SimulationTime > 0.0 ? LegacyTime / SimulationTime : 0.0);
+	}
+
+	static FAutoConsoleCommand BenchmarkCommand(
+		TEXT("Equipment.BenchmarkRangedWeaponSimulation"),
+		TEXT("Compares the per weapon heat/spread update with the SoA simulation, the layout and the baked curves measured separately. Args: [NumWeapons=300] [NumFrames=1000]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&RunBenchmark));
+}
+#endif
@@ -2,16 +2,38 @@
 
 
 #include "Equipment/WeaponInstance.h"
+#include "Equipment/EquipmentComponent.h"
+#include "Equipment/EquipmentTickSubsystem.h"
+#include "Equipment/RangedWeaponSimulation.h"
 #include "GameFramework/CharacterMovementComponent.h"
 #include "GameFramework/Character.h"
+#include "Components/SkinnedMeshComponent.h"
+#include "Engine/SkeletalMeshSocket.h"
 
 UPhysicalMaterialWithTags::UPhysicalMaterialWithTags(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
 {
 }
 
+#if WITH_EDITOR
+void UPhysicalMaterialWithTags::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	if (PropertyChangedEvent.GetMemberPropertyName() == GET_MEMBER_NAME_CHECKED(UPhysicalMaterialWithTags, Tags))
+		UWeaponInstance::InvalidateDamageMultiplierCaches();
+}
+
+int32 UWeaponInstance::DamageMultiplierCacheSerial = 0;
+#endif
+
 float UWeaponInstance::GetMaxDamageRange()
 {
+	if (BakedDistanceDamageFalloff.IsBaked()) {
+		float min, max;
+		BakedDistanceDamageFalloff.GetTimeRange(min, max);
+		return max;
+	}
 	if (const FRichCurve* curve = DistanceDamageFalloff.GetRichCurveConst()) {
 		float min, max;
 		curve->GetTimeRange(min, max);
@@ -22,6 +44,9 @@ float UWeaponInstance::GetMaxDamageRange()
 
 float UWeaponInstance::GetDamageAtDistance(float Distance)
 {
+	if (BakedDistanceDamageFalloff.IsBaked()) {
+		return BakedDistanceDamageFalloff.Eval(Distance);
+	}
 	if (const FRichCurve* curve = DistanceDamageFalloff.GetRichCurveConst()) {
 		return curve->Eval(Distance);
 	}
@@ -29,6 +54,29 @@ float UWeaponInstance::GetDamageAtDistance(float Distance)
 }
 
 float UWeaponInstance::GetDamageMultiplier(const UPhysicalMaterial* PhysicalMaterial)
+{
+	if (!PhysicalMaterial)
+		return 1.0f;
+
+	// the multipliers are class defaults, every instance of the class shares one table
+	const UWeaponInstance* Definition = GetClass()->GetDefaultObject<UWeaponInstance>();
+#if WITH_EDITOR
+	if (Definition->DamageMultiplierCacheBuiltSerial != DamageMultiplierCacheSerial)
+	{
+		Definition->DamageMultiplierCache.Reset();
+		Definition->DamageMultiplierCacheBuiltSerial = DamageMultiplierCacheSerial;
+	}
+#endif
+
+	if (const float* CachedMultiplier = Definition->DamageMultiplierCache.Find(PhysicalMaterial))
+		return *CachedMultiplier;
+
+	const float Multiplier = Definition->ComputeDamageMultiplier(PhysicalMaterial);
+	Definition->DamageMultiplierCache.Add(PhysicalMaterial, Multiplier);
+	return Multiplier;
+}
+
+float UWeaponInstance::ComputeDamageMultiplier(const UPhysicalMaterial* PhysicalMaterial) const
 {
 	float CombinedMultiplier = 1.0f;
 	if (const UPhysicalMaterialWithTags* PhysMatWithTags = Cast<const UPhysicalMaterialWithTags>(PhysicalMaterial))
@@ -44,76 +92,224 @@ float UWeaponInstance::GetDamageMultiplier(const UPhysicalMaterial* PhysicalMate
 	return CombinedMultiplier;
 }
 
-URangedWeaponInstance::URangedWeaponInstance(const FObjectInitializer& ObjectInitializer)
-	: Super(ObjectInitializer)
+#if WITH_EDITOR
+void UWeaponInstance::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
 {
-	HeatToHeatPerShotCurve.EditorCurveData.AddKey(0.0f, 1.0f);
-	HeatToCoolDownPerSecondCurve.EditorCurveData.AddKey(0.0f, 2.0f);
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	// child classes inherit the multipliers, all tables are dropped
+	if (PropertyChangedEvent.GetMemberPropertyName() == GET_MEMBER_NAME_CHECKED(UWeaponInstance, MaterialDamageMultiplier))
+		InvalidateDamageMultiplierCaches();
 }
+#endif
 
-void URangedWeaponInstance::Tick(float DeltaSeconds)
+void UWeaponInstance::OnEquipped()
 {
-	APawn* Pawn = GetPawn();
-	check(Pawn != nullptr);
+	BakeCurves();
+
+	Super::OnEquipped();
+}
+
+void UWeaponInstance::BakeCurves()
+{
+	if (const FRichCurve* curve = DistanceDamageFalloff.GetRichCurveConst()) {
+		BakedDistanceDamageFalloff.Bake(*curve, CurveBakeMaxSamples, CurveBakeMaxError);
+	}
+}
 
-	const bool bMinSpread = UpdateSpread(DeltaSeconds);
-	const bool bMinMultipliers = UpdateMultipliers(DeltaSeconds);
+URangedWeaponInstance::URangedWeaponInstance(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	HeatToHeatPerShotCurve.EditorCurveData.AddKey(0.0f, 1.0f);
+	HeatToCoolDownPerSecondCurve.EditorCurveData.AddKey(0.0f, 2.0f);
 }
 
 void URangedWeaponInstance::OnEquipped()
 {
 	Super::OnEquipped();
 
-	// Start heat in the middle
-	float MinHeatRange;
-	float MaxHeatRange;
-	ComputeHeatRange(/*out*/ MinHeatRange, /*out*/ MaxHeatRange);
-	CurrentHeat = (MinHeatRange + MaxHeatRange) * (EquipHeatAlpha / 100.f);
+	if (FRangedWeaponSimulation* Simulation = GetSimulation())
+	{
+		FRangedWeaponSimulationParams Params;
+		Params.HeatToSpreadCurve = &BakedHeatToSpreadCurve;
+		Params.HeatToCoolDownPerSecondCurve = &BakedHeatToCoolDownPerSecondCurve;
+		Params.MinHeat = CachedMinHeat;
+		Params.MaxHeat = CachedMaxHeat;
+
+		float MaxSpread;
+		BakedHeatToSpreadCurve.GetValueRange(/*out*/ Params.MinSpread, /*out*/ MaxSpread);
+
+		// Start heat in the middle
+		Params.InitialHeat = (Params.MinHeat + Params.MaxHeat) * (EquipHeatAlpha / 100.f);
 
-	// Derive spread
-	CurrentSpreadAngle = HeatToSpreadCurve.GetRichCurveConst()->Eval(CurrentHeat);
+		Params.TransitionRate_StandingStill = TransitionRate_StandingStill;
+		Params.TransitionRate_Crouching = TransitionRate_Crouching;
+		Params.TransitionRate_JumpingOrFalling = TransitionRate_JumpingOrFalling;
+		Params.bCanOverheat = bCanOverheat;
 
-	// Default the multipliers to 1x
-	CurrentSpreadAngleMultiplier = 1.0f;
-	StandingStillMultiplier = 1.0f;
-	JumpFallMultiplier = 1.0f;
-	CrouchingMultiplier = 1.0f;
+		Simulation->Add(this, Params);
+	}
 }
 
-void URangedWeaponInstance::AddSpread()
+void URangedWeaponInstance::OnUnequipped()
 {
-	// Sample the heat up curve
-	const float HeatPerShot = HeatToHeatPerShotCurve.GetRichCurveConst()->Eval(CurrentHeat);
-	CurrentHeat = ClampHeat(CurrentHeat + HeatPerShot);
+	Super::OnUnequipped();
+
+	if (SimulationIndex != INDEX_NONE)
+	{
+		if (FRangedWeaponSimulation* Simulation = GetSimulation())
+		{
+			Simulation->Remove(SimulationIndex);
+		}
+		SimulationIndex = INDEX_NONE;
+	}
+}
 
-	// Map the heat to the spread angle
-	CurrentSpreadAngle = HeatToSpreadCurve.GetRichCurveConst()->Eval(CurrentHeat);
+void URangedWeaponInstance::AddSpread()
+{
+	FRangedWeaponSimulation* Simulation = GetSimulation();
+	if (Simulation && SimulationIndex != INDEX_NONE)
+	{
+		// Sample the heat up curve, the simulation maps the new heat to the spread angle
+		const float HeatPerShot = BakedHeatToHeatPerShotCurve.Eval(Simulation->GetHeat(SimulationIndex));
+		Simulation->AddHeat(SimulationIndex, HeatPerShot);
+	}
 }
 
 float URangedWeaponInstance::GetSpreadAngle(bool bIgnoreMultiplier)
 {
-	return bIgnoreMultiplier ? CurrentSpreadAngle : CurrentSpreadAngle * CurrentSpreadAngleMultiplier;
+	const FRangedWeaponSimulation* Simulation = GetSimulation();
+	if (Simulation && SimulationIndex != INDEX_NONE)
+	{
+		const float SpreadAngle = Simulation->GetSpreadAngle(SimulationIndex);
+		return bIgnoreMultiplier ? SpreadAngle : SpreadAngle * Simulation->GetSpreadAngleMultiplier(SimulationIndex);
+	}
+	return 0.0f;
 }
 
 float URangedWeaponInstance::GetHeat() const
 {
-	return CurrentHeat;
+	const FRangedWeaponSimulation* Simulation = GetSimulation();
+	return Simulation && SimulationIndex != INDEX_NONE ? Simulation->GetHeat(SimulationIndex) : 0.0f;
+}
+
+bool URangedWeaponInstance::IsOverheated() const
+{
+	const FRangedWeaponSimulation* Simulation = GetSimulation();
+	return Simulation && SimulationIndex != INDEX_NONE && Simulation->IsOverheated(SimulationIndex);
 }
 
 FTransform URangedWeaponInstance::GetMuzzleTransform() const
 {
-	if (GetSpawnedActors().Num() > 0) {
-		return GetSpawnedActors()[0]->GetRootComponent()->GetSocketTransform("Muzzle");
-	}
-	return FTransform();
+	if (!MuzzleCache.bResolved || MuzzleCache.Component.IsStale())
+		ResolveMuzzle();
+
+	const USceneComponent* Component = MuzzleCache.Component.Get();
+	if (!Component)
+		return FTransform();
+	if (MuzzleCache.BoneIndex != INDEX_NONE)
+		return MuzzleCache.Relative * static_cast<const USkinnedMeshComponent*>(Component)->GetBoneTransform(MuzzleCache.BoneIndex);
+	return MuzzleCache.Relative * Component->GetComponentTransform();
 }
 
 FVector URangedWeaponInstance::GetMuzzleLocation() const
 {
-	if (GetSpawnedActors().Num() > 0) {
-		return GetSpawnedActors()[0]->GetRootComponent()->GetSocketLocation("Muzzle");
+	return GetMuzzleTransform().GetLocation();
+}
+
+void URangedWeaponInstance::OnEquipmentActorsChanged()
+{
+	MuzzleCache = FMuzzleCache();
+}
+
+void URangedWeaponInstance::ResolveMuzzle() const
+{
+	static const FName DefaultMuzzleSocket("Muzzle");
+
+	MuzzleCache = FMuzzleCache();
+	MuzzleCache.bResolved = true;
+
+	const TArray<FEquipmentActorToSpawn>* ActorsToSpawn = GetEquipmentDefinition() ? &GetDefault<UEquipmentDefinition>(GetEquipmentDefinition())->ActorsToSpawn : nullptr;
+
+	for (const TConstArrayView<TObjectPtr<AActor>>& Actors : { GetSpawnedActorsView(), GetCosmeticActorsView() })
+	{
+		for (const AActor* Actor : Actors)
+		{
+			if (!Actor)
+				continue;
+
+			// the muzzle socket is configured on the spawn info the actor came from
+			const FEquipmentActorToSpawn* SpawnInfo = ActorsToSpawn ? ActorsToSpawn->FindByPredicate([Actor](const FEquipmentActorToSpawn& Info) { return Info.ActorToSpawn.Get() == Actor->GetClass(); }) : nullptr;
+			const FName Socket = SpawnInfo ? SpawnInfo->MuzzleSocket : DefaultMuzzleSocket;
+			if (Socket.IsNone())
+				continue;
+
+			const USceneComponent* Root = Actor->GetRootComponent();
+			if (Root && Root->DoesSocketExist(Socket))
+			{
+				SetMuzzle(Root, Socket, FTransform::Identity);
+				return;
+			}
+
+			TInlineComponentArray<UMeshComponent*> Meshes(Actor);
+			for (const UMeshComponent* Mesh : Meshes)
+			{
+				if (Mesh != Root && Mesh->DoesSocketExist(Socket))
+				{
+					SetMuzzle(Mesh, Socket, FTransform::Identity);
+					return;
+				}
+			}
+		}
 	}
-	return FVector();
+
+	if (GetSpawnedActorsView().Num() > 0 && GetSpawnedActorsView()[0]) {
+		SetMuzzle(GetSpawnedActorsView()[0]->GetRootComponent(), NAME_None, FTransform::Identity);
+		return;
+	}
+
+	// the weapon actor is cosmetic and not spawned here, the muzzle is placed where it would be
+	const USceneComponent* AttachTarget = GetAttachTarget();
+	if (!AttachTarget)
+		return;
+
+	const FEquipmentActorToSpawn* WeaponActor = ActorsToSpawn ? ActorsToSpawn->FindByPredicate([](const FEquipmentActorToSpawn& SpawnInfo) { return !SpawnInfo.bGameplayRelevant; }) : nullptr;
+	if (!WeaponActor)
+	{
+		SetMuzzle(AttachTarget, NAME_None, FTransform::Identity);
+		return;
+	}
+	SetMuzzle(AttachTarget, WeaponActor->AttachSocket, MuzzleProxyOffset * WeaponActor->AttachTransform);
+}
+
+void URangedWeaponInstance::SetMuzzle(const USceneComponent* Component, FName Socket, const FTransform& Offset) const
+{
+	MuzzleCache.Component = Component;
+	MuzzleCache.BoneIndex = INDEX_NONE;
+	MuzzleCache.Relative = Offset;
+	if (!Component || Socket.IsNone())
+		return;
+
+	if (const USkinnedMeshComponent* SkinnedMesh = Cast<USkinnedMeshComponent>(Component))
+	{
+		// a mesh socket is an offset from a bone, a bone name is used as is
+		FName BoneName = Socket;
+		FTransform SocketLocal = FTransform::Identity;
+		if (const USkeletalMeshSocket* MeshSocket = SkinnedMesh->GetSocketByName(Socket))
+		{
+			BoneName = MeshSocket->BoneName;
+			SocketLocal = MeshSocket->GetSocketLocalTransform();
+		}
+		MuzzleCache.BoneIndex = SkinnedMesh->GetBoneIndex(BoneName);
+		if (MuzzleCache.BoneIndex != INDEX_NONE)
+		{
+			MuzzleCache.Relative = Offset * SocketLocal;
+			return;
+		}
+	}
+
+	// other components don't animate their sockets
+	MuzzleCache.Relative = Offset * Component->GetSocketTransform(Socket, RTS_Component);
 }
 
 int32 URangedWeaponInstance::GetHitsPerAttack() const
@@ -154,52 +350,46 @@ void URangedWeaponInstance::ComputeHeatRange(float& MinHeat, float& MaxHeat)
 	MaxHeat = FMath::Max(FMath::Max(Max1, Max2), Max3);
 }
 
-bool URangedWeaponInstance::UpdateSpread(float DeltaSeconds)
+void URangedWeaponInstance::BakeCurves()
 {
-	const float TimeSinceFired = GetWorld()->TimeSince(GetTimeLastUsed());
+	Super::BakeCurves();
 
-	if (TimeSinceFired > SpreadRecoveryCooldownDelay)
-	{
-		const float CooldownRate = HeatToCoolDownPerSecondCurve.GetRichCurveConst()->Eval(CurrentHeat);
-		CurrentHeat = ClampHeat(CurrentHeat - (CooldownRate * DeltaSeconds));
-		CurrentSpreadAngle = HeatToSpreadCurve.GetRichCurveConst()->Eval(CurrentHeat);
-	}
-
-	float MinSpread;
-	float MaxSpread;
-	HeatToSpreadCurve.GetRichCurveConst()->GetValueRange(/*out*/ MinSpread, /*out*/ MaxSpread);
+	BakedHeatToSpreadCurve.Bake(*HeatToSpreadCurve.GetRichCurveConst(), CurveBakeMaxSamples, CurveBakeMaxError);
+	BakedHeatToHeatPerShotCurve.Bake(*HeatToHeatPerShotCurve.GetRichCurveConst(), CurveBakeMaxSamples, CurveBakeMaxError);
+	BakedHeatToCoolDownPerSecondCurve.Bake(*HeatToCoolDownPerSecondCurve.GetRichCurveConst(), CurveBakeMaxSamples, CurveBakeMaxError);
 
-	return FMath::IsNearlyEqual(CurrentSpreadAngle, MinSpread, KINDA_SMALL_NUMBER);
+	ComputeHeatRange(/*out*/ CachedMinHeat, /*out*/ CachedMaxHeat);
 }
 
-bool URangedWeaponInstance::UpdateMultipliers(float DeltaSeconds)
+FRangedWeaponSimulation* URangedWeaponInstance::GetSimulation() const
 {
-	const float MultiplierNearlyEqualThreshold = 0.05f;
+	if (UEquipmentTickSubsystem* TickSubsystem = UWorld::GetSubsystem<UEquipmentTickSubsystem>(GetWorld()))
+	{
+		return &TickSubsystem->GetRangedWeaponSimulation();
+	}
+	return nullptr;
+}
 
-	APawn* Pawn = GetPawn();
+void URangedWeaponInstance::GatherMultiplierTargets(FRangedWeaponMultiplierTargets& OutTargets) const
+{
+	const APawn* Pawn = GetPawn();
 	check(Pawn != nullptr);
-	UCharacterMovementComponent* CharMovementComp = Cast<UCharacterMovementComponent>(Pawn->GetMovementComponent());
+	const UCharacterMovementComponent* CharMovementComp = Cast<UCharacterMovementComponent>(Pawn->GetMovementComponent());
 
-	// See if we are standing still, and if so, smoothly apply the bonus
+	// See if we are standing still, and if so, apply the bonus
 	const float PawnSpeed = Pawn->GetVelocity().Size();
-	const float MovementTargetValue = FMath::GetMappedRangeValueClamped(
+	OutTargets.StandingStill = FMath::GetMappedRangeValueClamped(
 		/*InputRange=*/ FVector2D(StandingStillSpeedThreshold, StandingStillSpeedThreshold + StandingStillToMovingSpeedRange),
 		/*OutputRange=*/ FVector2D(SpreadAngleMultiplier_StandingStill, 1.0f),
 		/*Alpha=*/ PawnSpeed);
-	StandingStillMultiplier = FMath::FInterpTo(StandingStillMultiplier, MovementTargetValue, DeltaSeconds, TransitionRate_StandingStill);
-	const bool bStandingStillMultiplierAtMin = FMath::IsNearlyEqual(StandingStillMultiplier, SpreadAngleMultiplier_StandingStill, SpreadAngleMultiplier_StandingStill * 0.1f);
 
-	// See if we are crouching, and if so, smoothly apply the bonus
+	// See if we are crouching, and if so, apply the bonus
 	const bool bIsCrouching = (CharMovementComp != nullptr) && CharMovementComp->IsCrouching();
-	const float CrouchingTargetValue = bIsCrouching ? SpreadAngleMultiplier_Crouching : 1.0f;
-	CrouchingMultiplier = FMath::FInterpTo(CrouchingMultiplier, CrouchingTargetValue, DeltaSeconds, TransitionRate_Crouching);
-	const bool bCrouchingMultiplierAtTarget = FMath::IsNearlyEqual(CrouchingMultiplier, CrouchingTargetValue, MultiplierNearlyEqualThreshold);
+	OutTargets.Crouching = bIsCrouching ? SpreadAngleMultiplier_Crouching : 1.0f;
 
-	// See if we are in the air (jumping/falling), and if so, smoothly apply the penalty
+	// See if we are in the air (jumping/falling), and if so, apply the penalty
 	const bool bIsJumpingOrFalling = (CharMovementComp != nullptr) && CharMovementComp->IsFalling();
-	const float JumpFallTargetValue = bIsJumpingOrFalling ? SpreadAngleMultiplier_JumpingOrFalling : 1.0f;
-	JumpFallMultiplier = FMath::FInterpTo(JumpFallMultiplier, JumpFallTargetValue, DeltaSeconds, TransitionRate_JumpingOrFalling);
-	const bool bJumpFallMultiplerIs1 = FMath::IsNearlyEqual(JumpFallMultiplier, 1.0f, MultiplierNearlyEqualThreshold);
+	OutTargets.JumpingOrFalling = bIsJumpingOrFalling ? SpreadAngleMultiplier_JumpingOrFalling : 1.0f;
 
 	// Determine if we are aiming down sights, and apply the bonus based on how far into the camera transition we are
 	float AimingAlpha = 0.0f;
@@ -212,16 +402,32 @@ bool URangedWeaponInstance::UpdateMultipliers(float DeltaSeconds)
 
 	//	AimingAlpha = (TopCameraTag == TAG_Lyra_Weapon_SteadyAimingCamera) ? TopCameraWeight : 0.0f;
 	//}
-	const float AimingMultiplier = FMath::GetMappedRangeValueClamped(
+	OutTargets.Aiming = FMath::GetMappedRangeValueClamped(
 		/*InputRange=*/ FVector2D(0.0f, 1.0f),
 		/*OutputRange=*/ FVector2D(1.0f, SpreadAngleMultiplier_Aiming),
 		/*Alpha=*/ AimingAlpha);
-	const bool bAimingMultiplierAtTarget = FMath::IsNearlyEqual(AimingMultiplier, SpreadAngleMultiplier_Aiming, KINDA_SMALL_NUMBER);
+}
 
-	// Combine all the multipliers
-	const float CombinedMultiplier = AimingMultiplier * StandingStillMultiplier * CrouchingMultiplier * JumpFallMultiplier;
-	CurrentSpreadAngleMultiplier = CombinedMultiplier;
+uint8 URangedWeaponInstance::GetMovementState() const
+{
+	const APawn* Pawn = GetPawn();
+	if (Pawn == nullptr)
+	{
+		return 0;
+	}
+
+	const UCharacterMovementComponent* CharMovementComp = Cast<UCharacterMovementComponent>(Pawn->GetMovementComponent());
+	const float PawnSpeedSquared = Pawn->GetVelocity().SizeSquared();
+	const bool bStandingStill = PawnSpeedSquared <= FMath::Square(StandingStillSpeedThreshold);
+	const bool bMoving = PawnSpeedSquared >= FMath::Square(StandingStillSpeedThreshold + StandingStillToMovingSpeedRange);
+	const bool bIsCrouching = (CharMovementComp != nullptr) && CharMovementComp->IsCrouching();
+	const bool bIsJumpingOrFalling = (CharMovementComp != nullptr) && CharMovementComp->IsFalling();
+
+	// in between standing still and moving the target multiplier depends on the exact speed, so never sleep there
+	if (!bStandingStill && !bMoving)
+	{
+		return FRangedWeaponSimulation::MovementStateInTransition;
+	}
 
-	// need to handle these spread multipliers indicating we are not at min spread
-	return bStandingStillMultiplierAtMin && bCrouchingMultiplierAtTarget && bJumpFallMultiplerIs1 && bAimingMultiplierAtTarget;
+	return (bStandingStill ? 1 : 0) | (bIsCrouching ? 2 : 0) | (bIsJumpingOrFalling ? 4 : 0);
 }
@@ -5,6 +5,7 @@
 #include "Inventory/InventoryItemInstance.h"
 #include "Equipment/EquipmentComponent.h"
 #include "Equipment/EquipmentInstance.h"
+#include "Inventory/LoadoutPreset.h"
 #include "NativeGameplayTags.h"
 #include "GameFrameWork/PlayerState.h"
 
@@ -159,6 +160,11 @@ UInventoryItemInstance* UInventoryComponent::AddItemDefinition(TSubclassOf<UInve
 				else
 					break;
 			}
+
+			// start streaming the equipment in before the item is put into a slot
+			if (Result)
+				if (UEquipmentComponent* EquipmentComponent = FindEquipmentManager())
+					EquipmentComponent->PreloadItem(Result);
 		}
 	}
 	return Result;
@@ -170,6 +176,9 @@ bool UInventoryComponent::AddItemInstance(UInventoryItemInstance* instance, int3
 		TSubclassOf<UInventoryItemDefinition> itemDefToAdd = instance->GetItemDef();
 		if (CanAddItemToInventory(itemDefToAdd, stackCount))
 		{
+			if (UEquipmentComponent* EquipmentComponent = FindEquipmentManager())
+				EquipmentComponent->PreloadItem(instance);
+
 			if (itemDefToAdd->GetDefaultObject<UInventoryItemDefinition>()->bInstancesAlwaysStack)
 			{
 				for (auto EntryIt = inventoryList.CreateIterator(); EntryIt; ++EntryIt)
@@ -211,6 +220,64 @@ bool UInventoryComponent::AddItemInstance(UInventoryItemInstance* instance, int3
 	return false;
 }
 
+void UInventoryComponent::ApplyLoadout(TConstArrayView<FLoadout> loadout)
+{
+	UEquipmentComponent* EquipmentComponent = FindEquipmentManager();
+	auto IsSlotted = [EquipmentComponent](const UInventoryItemInstance* instance) { return EquipmentComponent && EquipmentComponent->IsItemInSlot(instance); };
+
+	TArray<FEquipmentLoadoutEntry> toEquip;
+	// amount of each definition the loadout asks for so far, entries of the same definition share the inventory stacks
+	TMap<TSubclassOf<UInventoryItemDefinition>, int32> requiredCounts;
+	TSet<UInventoryItemInstance*> usedInstances;
+
+	for (const FLoadout& info : loadout)
+	{
+		TSubclassOf<UInventoryItemDefinition> itemDef = info.item.Definition;
+		if (!itemDef)
+			continue;
+
+		int32& required = requiredCounts.FindOrAdd(itemDef);
+		required += info.item.Amount;
+
+		int32 owned = 0;
+		UInventoryItemInstance* item = nullptr;
+		for (const FInventoryEntry& Entry : inventoryList)
+		{
+			if (Entry.instance->itemDef == itemDef)
+			{
+				owned += Entry.stackCount;
+				// an instance that is already slotted is kept over another one of the same definition
+				if (!usedInstances.Contains(Entry.instance) && (item == nullptr || (!IsSlotted(item) && IsSlotted(Entry.instance))))
+					item = Entry.instance;
+			}
+		}
+
+		// only what is missing gets added, a respawn keeps what the inventory already holds
+		int32 missing = required - owned;
+		if (missing > 0)
+		{
+			UInventoryItemInstance* added = AddItemDefinition(itemDef, missing);
+			if (item == nullptr)
+				item = added;
+		}
+
+		if (item && info.bEquipItem)
+		{
+			usedInstances.Add(item);
+			toEquip.Add({ info.slotID, item });
+		}
+	}
+
+	if (EquipmentComponent)
+		EquipmentComponent->ApplyLoadout(toEquip);
+}
+
+void UInventoryComponent::ApplyLoadoutPreset(const ULoadoutPreset* preset)
+{
+	if (preset)
+		ApplyLoadout(preset->Items);
+}
+
 UInventoryItemInstance* UInventoryComponent::RemoveItemInstance(UInventoryItemInstance* instance, int32& stackCount)
 {
 	UInventoryItemInstance* Result = nullptr;
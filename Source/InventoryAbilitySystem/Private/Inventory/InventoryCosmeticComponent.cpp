@@ -6,7 +6,48 @@
 UE_DEFINE_GAMEPLAY_TAG(TAG_Cosmetic_AnimationStyle, "Cosmetic.AnimationStyle");
 UE_DEFINE_GAMEPLAY_TAG(TAG_Cosmetic_BodyStyle, "Cosmetic.BodyStyle");
 
+void FCosmeticTagSet::Build(const FGameplayTagContainer& SourceTags, FGameplayTag RequiredPrefix)
+{
+	Tags.Reset();
+	Hash = 0;
+
+	for (const FGameplayTag& Tag : SourceTags)
+	{
+		if (!RequiredPrefix.IsValid() || Tag.MatchesTag(RequiredPrefix))
+		{
+			Tags.AddTagFast(Tag);
+			// summed so the order of the tags doesn't matter
+			Hash += MurmurFinalize32(GetTypeHash(Tag));
+		}
+	}
+}
+
+void UInventoryCosmeticComponent::SetAnimationStyleTags(const FGameplayTagContainer& NewTags)
+{
+	AnimationStyleTags = NewTags;
+	filteredTags.Reset();
+}
+
 FGameplayTagContainer UInventoryCosmeticComponent::GetCombinedTags(FGameplayTag RequiredPrefix) const
 {
-	return AnimationStyleTags;
+	return GetFilteredTags(RequiredPrefix).Tags;
+}
+
+const FCosmeticTagSet& UInventoryCosmeticComponent::GetFilteredTags(FGameplayTag RequiredPrefix) const
+{
+	if (const FCosmeticTagSet* Cached = filteredTags.Find(RequiredPrefix))
+		return *Cached;
+
+	FCosmeticTagSet& NewSet = filteredTags.Add(RequiredPrefix);
+	NewSet.Build(AnimationStyleTags, RequiredPrefix);
+	return NewSet;
+}
+
+#if WITH_EDITOR
+void UInventoryCosmeticComponent::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	filteredTags.Reset();
 }
+#endif
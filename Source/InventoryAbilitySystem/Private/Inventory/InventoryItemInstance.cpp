@@ -114,6 +114,17 @@ void UInventoryItemInstance::RemoveStatTagStack(FGameplayTag Tag, int32 StackCou
 	StatTags.RemoveStack(Tag, StackCount);
 }
 
+uint32 UInventoryItemInstance::GetBodySlotMask() const
+{
+	if (!bBodySlotMaskCached)
+	{
+		const UInventoryFragment_BodySlots* BodySlots = FindFragmentByClass<UInventoryFragment_BodySlots>();
+		bodySlotMask = BodySlots ? BodySlots->GetSlotMask() : 0;
+		bBodySlotMaskCached = true;
+	}
+	return bodySlotMask;
+}
+
 int32 UInventoryItemInstance::GetStatTagStackCount(FGameplayTag Tag) const
 {
 	return StatTags.GetStackCount(Tag);
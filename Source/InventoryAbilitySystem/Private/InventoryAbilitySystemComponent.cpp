@@ -3,6 +3,7 @@
 
 #include "Ability/InventoryAbilitySystemComponent.h"
 #include "Ability/InventoryGlobalAbilitySystem.h"
+#include "Equipment/EquipmentInstance.h"
 
 DEFINE_LOG_CATEGORY(LogInventoryAbilitySystem);
 
@@ -112,13 +113,19 @@ void UInventoryAbilitySystemComponent::CancelInputActivatedAbilities(bool bRepli
 	CancelAbilitiesByFunc(ShouldCancelFunc, bReplicateCancelAbility);
 }
 
+bool UInventoryAbilitySystemComponent::IsFromDormantEquipment(const FGameplayAbilitySpec& AbilitySpec)
+{
+	const UEquipmentInstance* Equipment = Cast<UEquipmentInstance>(AbilitySpec.SourceObject.Get());
+	return Equipment && Equipment->IsDormant();
+}
+
 void UInventoryAbilitySystemComponent::AbilityInputTagPressed(const FGameplayTag& InputTag)
 {
 	if (InputTag.IsValid())
 	{
 		for (const FGameplayAbilitySpec& AbilitySpec : ActivatableAbilities.Items)
 		{
-			if (AbilitySpec.Ability && (AbilitySpec.GetDynamicSpecSourceTags().HasTagExact(InputTag)))
+			if (AbilitySpec.Ability && (AbilitySpec.GetDynamicSpecSourceTags().HasTagExact(InputTag)) && !IsFromDormantEquipment(AbilitySpec))
 			{
 				InputPressedSpecHandles.AddUnique(AbilitySpec.Handle);
 				InputHeldSpecHandles.AddUnique(AbilitySpec.Handle);
@@ -7,8 +7,10 @@
 #include "Equipment/EquipmentComponent.h"
 #include "Inventory/InventoryComponent.h"
 #include "Inventory/InventoryItemInstance.h"
+#include "Inventory/LoadoutPreset.h"
 #include "Inventory/InventoryCosmeticComponent.h"
 #include "Ability/InventoryAbilitySystemComponent.h"
+#include "Ability/LagCompensationSubsystem.h"
 #include "InventoryInputConfig.h"
 #include "InventoryAbilitySystem/InventoryGameplayTags.h"
 
@@ -28,10 +30,25 @@ AAbilityCharacter::AAbilityCharacter()
 	teamID = FGenericTeamId::NoTeam;
 }
 
+void AAbilityCharacter::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// the server keeps a history of our capsule to validate the hits clients claim on us
+	if (HasAuthority())
+	{
+		if (ULagCompensationSubsystem* LagCompensation = UWorld::GetSubsystem<ULagCompensationSubsystem>(GetWorld()))
+			LagCompensation->RegisterPawn(this);
+	}
+}
+
 void AAbilityCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
 	UninitializeAbilitySystem();
 
+	if (ULagCompensationSubsystem* LagCompensation = UWorld::GetSubsystem<ULagCompensationSubsystem>(GetWorld()))
+		LagCompensation->UnregisterPawn(this);
+
 	Super::EndPlay(EndPlayReason);
 }
 
@@ -61,17 +78,10 @@ void AAbilityCharacter::PossessedBy(AController* NewController)
 	}
 
 	if (UInventoryComponent* inventory = NewController->GetComponentByClass<UInventoryComponent>()) {
-		for (int i = 0; i < initialLoadout.Num(); i++) {
-			FLoadout info = initialLoadout[i];
-			if (UInventoryItemInstance* item = inventory->AddItemDefinition(info.item.Definition, info.item.Amount)) {
-				if(info.bEquipItem)
-				{
-					if (UEquipmentComponent* equipment = inventory->FindEquipmentManager()) {
-						equipment->AddItemToSlot(info.slotID, item);
-					}
-				}
-			}
-		}
+		TArray<FLoadout> loadout = initialLoadout;
+		if (loadoutPreset)
+			loadout.Append(loadoutPreset->Items);
+		inventory->ApplyLoadout(loadout);
 	}
 }
 
@@ -6,8 +6,10 @@
 #include "Equipment/EquipmentComponent.h"
 #include "Inventory/InventoryComponent.h"
 #include "Inventory/InventoryItemInstance.h"
+#include "Inventory/LoadoutPreset.h"
 #include "Ability/AttributeComponent.h"
 #include "Ability/InventoryAbilitySystemComponent.h"
+#include "Ability/LagCompensationSubsystem.h"
 #include "InventoryAbilitySystem/InventoryGameplayTags.h"
 
 // Sets default values
@@ -21,10 +23,25 @@ AAbilityPawn::AAbilityPawn()
 	teamID = FGenericTeamId::NoTeam;
 }
 
+void AAbilityPawn::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// the server keeps a history of our capsule to validate the hits clients claim on us
+	if (HasAuthority())
+	{
+		if (ULagCompensationSubsystem* LagCompensation = UWorld::GetSubsystem<ULagCompensationSubsystem>(GetWorld()))
+			LagCompensation->RegisterPawn(this);
+	}
+}
+
 void AAbilityPawn::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
 	UninitializeAbilitySystem();
 
+	if (ULagCompensationSubsystem* LagCompensation = UWorld::GetSubsystem<ULagCompensationSubsystem>(GetWorld()))
+		LagCompensation->UnregisterPawn(this);
+
 	Super::EndPlay(EndPlayReason);
 }
 
@@ -54,18 +71,10 @@ void AAbilityPawn::PossessedBy(AController* NewController)
 	}
 
 	if (UInventoryComponent* inventory = NewController->GetComponentByClass<UInventoryComponent>()) {
-		int slot = 0;
-		for (int i = 0; i < initialLoadout.Num(); i++) {
-			FLoadout info = initialLoadout[i];
-			if (UInventoryItemInstance* item = inventory->AddItemDefinition(info.item.Definition, info.item.Amount)) {
-				if(info.bEquipItem)
-				{
-					if (UEquipmentComponent* equipment = inventory->FindEquipmentManager()) {
-						equipment->AddItemToSlot(info.slotID, item);
-					}
-				}
-			}
-		}
+		TArray<FLoadout> loadout = initialLoadout;
+		if (loadoutPreset)
+			loadout.Append(loadoutPreset->Items);
+		inventory->ApplyLoadout(loadout);
 	}
 }
 
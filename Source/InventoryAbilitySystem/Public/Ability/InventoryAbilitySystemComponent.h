@@ -46,6 +46,9 @@ public:
 protected:
 	void TryActivateAbilitiesOnSpawn();
 
+	// abilities of dormant equipment stay granted but don't take input
+	static bool IsFromDormantEquipment(const FGameplayAbilitySpec& AbilitySpec);
+
 	virtual void AbilitySpecInputPressed(FGameplayAbilitySpec& Spec) override;
 	virtual void AbilitySpecInputReleased(FGameplayAbilitySpec& Spec) override;
 
@@ -0,0 +1,77 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Abilities/GameplayAbilityTargetTypes.h"
+#include "InventoryGameplayAbilityTargetData_WeaponHits.generated.h"
+
+class UPhysicalMaterial;
+
+/** One hit of a volley, positions are relative to the shared trace start */
+struct FInventoryWeaponHit
+{
+	TWeakObjectPtr<AActor> Actor;
+	FVector ImpactOffset = FVector::ZeroVector;
+	// trace start of this hit relative to the shared one, zero unless the pellets of the volley started from different points
+	FVector OriginOffset = FVector::ZeroVector;
+	FVector ImpactNormal = FVector::ZeroVector;
+	TWeakObjectPtr<UPhysicalMaterial> PhysMaterial;
+	// pellet of the attack this hit came from
+	uint8 ShotIndex = 0;
+};
+
+/**
+ * All hits of one weapon attack in a single target data, sent instead of one FGameplayAbilityTargetData_SingleTargetHit per hit.
+ * Only the actor, the impact point quantized to 1uu, the normal in 8 bits per component, the physical material and the shot index go over the wire.
+ * The trace start of a hit is only sent when the pellets of the volley didn't all start at TraceStart.
+ * Actors and physical materials are sent as net GUIDs, which is an index once the client knows them.
+ */
+USTRUCT()
+struct INVENTORYABILITYSYSTEM_API FInventoryGameplayAbilityTargetData_WeaponHits : public FGameplayAbilityTargetData
+{
+	GENERATED_BODY()
+
+	// hits of a volley past this are dropped
+	static constexpr int32 MaxHits = 255;
+
+	FVector TraceStart = FVector::ZeroVector;
+
+	TArray<FInventoryWeaponHit> Hits;
+
+	// set if the pellets were generated from the attack seed, the server then regenerates them from these and the seed it derives from AttackIndex
+	// see UInventoryGameplayAbility_RangedWeapon::GeneratePelletDirections
+	bool bSeeded = false;
+	FVector AimDirection = FVector::ForwardVector;
+	// full cone angle in degrees, sent with a precision of 0.01
+	float SpreadAngle = 0.0f;
+	// attack of the activation, automatic fire sends several per target data, see UInventoryGameplayAbility_RangedWeapon::StartAutomaticFire
+	int32 AttackIndex = 0;
+	// seconds since the first attack of the activation, sent with a precision of 1ms
+	float ShotTime = 0.0f;
+
+	void AddHit(const FHitResult& Hit, uint8 ShotIndex);
+
+	// rebuilds a hit result from the compact hit
+	FHitResult MakeHitResult(int32 HitIndex) const;
+
+	// replaces every WeaponHits entry of the handle by one FGameplayAbilityTargetData_SingleTargetHit per hit
+	static void ExpandHits(FGameplayAbilityTargetDataHandle& TargetData);
+
+	//~FGameplayAbilityTargetData interface
+	virtual TArray<TWeakObjectPtr<AActor>> GetActors() const override;
+	virtual UScriptStruct* GetScriptStruct() const override { return StaticStruct(); }
+	virtual FString ToString() const override;
+	//~End of FGameplayAbilityTargetData interface
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FInventoryGameplayAbilityTargetData_WeaponHits> : public TStructOpsTypeTraitsBase2<FInventoryGameplayAbilityTargetData_WeaponHits>
+{
+	enum
+	{
+		WithNetSerializer = true
+	};
+};
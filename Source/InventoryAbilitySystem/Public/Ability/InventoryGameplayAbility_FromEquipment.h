@@ -22,6 +22,9 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Ability")
 		class UInventoryItemInstance* GetAssociatedItem() const;
 
+	// dormant equipment keeps its abilities granted but they can't be activated
+	virtual bool CanActivateAbility(const FGameplayAbilitySpecHandle Handle, const FGameplayAbilityActorInfo* ActorInfo, const FGameplayTagContainer* SourceTags = nullptr, const FGameplayTagContainer* TargetTags = nullptr, FGameplayTagContainer* OptionalRelevantTags = nullptr) const override;
+
 #if WITH_EDITOR
 	virtual EDataValidationResult IsDataValid(class FDataValidationContext& Context) const override;
 #endif
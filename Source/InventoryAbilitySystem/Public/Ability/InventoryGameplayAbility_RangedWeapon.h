@@ -3,6 +3,7 @@
 #pragma once
 
 #include "InventoryGameplayAbility_Weapon.h"
+#include "Engine/TimerHandle.h"
 #include "InventoryGameplayAbility_RangedWeapon.generated.h"
 
 /** Defines where an ability starts its trace from and where it should face */
@@ -23,17 +24,43 @@ enum class ETargetingSource : uint8
 	Custom
 };
 
+/** How often one attack may hit the same actor */
+UENUM(BlueprintType)
+enum class EWeaponHitDeduplication : uint8
+{
+	// every pellet may hit an actor once, shotgun pellets stack
+	PerPellet,
+	// the whole volley hits an actor once
+	PerVolley
+};
+
+// actors already hit by a pellet or volley, small attacks stay off the heap
+using FWeaponHitSet = TSet<FActorInstanceHandle, DefaultKeyFuncs<FActorInstanceHandle>, TInlineSetAllocator<16>>;
+
 UCLASS()
 class INVENTORYABILITYSYSTEM_API UInventoryGameplayAbility_RangedWeapon : public UInventoryGameplayAbility_Weapon
 {
 	GENERATED_BODY()
 
 protected:
+	// StartRangedWeaponTargeting traces the pellets asynchronously and submits the hits once all returned, usually the next frame
+	UPROPERTY(EditDefaultsOnly, Category = "Targeting")
+		bool bAsyncPelletTraces = false;
+
+	// how StartRangedWeaponTargeting collects the hits of the pellets
+	UPROPERTY(EditDefaultsOnly, Category = "Targeting")
+		EWeaponHitDeduplication HitDeduplication = EWeaponHitDeduplication::PerPellet;
+
 	//UGameplayAbility interface
 	virtual bool CanActivateAbility(const FGameplayAbilitySpecHandle Handle, const FGameplayAbilityActorInfo* ActorInfo, const FGameplayTagContainer* SourceTags = nullptr, const FGameplayTagContainer* TargetTags = nullptr, FGameplayTagContainer* OptionalRelevantTags = nullptr) const override;
+	virtual void ActivateAbility(const FGameplayAbilitySpecHandle Handle, const FGameplayAbilityActorInfo* ActorInfo, const FGameplayAbilityActivationInfo ActivationInfo, const FGameplayEventData* TriggerEventData) override;
+	virtual void EndAbility(const FGameplayAbilitySpecHandle Handle, const FGameplayAbilityActorInfo* ActorInfo, const FGameplayAbilityActivationInfo ActivationInfo, bool bReplicateEndAbility, bool bWasCancelled) override;
 	virtual void PostCommitAbility() override;
 	//end UGameplayAbility interface
 
+	// with a ProjectileDefinition the target data of a remote client are the volleys of FireProjectiles instead of hits
+	virtual void OnTargetDataReadyCallback(const FGameplayAbilityTargetDataHandle& InData, FGameplayTag ApplicationTag) override;
+
 	virtual void AddAdditionalTraceIgnoreActors(FCollisionQueryParams& TraceParams) const;
 
 	// Determine the trace channel to use for the weapon trace(s)
@@ -43,7 +70,89 @@ protected:
 	UFUNCTION(BlueprintCallable)
 		FHitResult WeaponTrace(const FVector& StartTrace, const FVector& EndTrace, float SweepRadius, bool bIsSimulated, TArray<FHitResult>& OutHitResults) const;
 
+	// query params and channel shared by all traces of an attack
+	ECollisionChannel InitTraceParams(FCollisionQueryParams& TraceParams, bool bIsSimulated) const;
+	// WeaponTrace with params prepared by InitTraceParams, hits on actors in SeenHits are skipped.
+	// Unlike WeaponTrace it returns an empty hit when the trace found no new actor
+	FHitResult WeaponTraceWithParams(const FVector& StartTrace, const FVector& EndTrace, float SweepRadius, ECollisionChannel TraceChannel, const FCollisionQueryParams& TraceParams, FWeaponHitSet& SeenHits, TArray<FHitResult>& OutHitResults) const;
+
+	// Traces every pellet of the attack from the source and submits the hits, the native replacement of PerformLocalTargeting + StartWeaponTargeting
+	UFUNCTION(BlueprintCallable)
+		void StartRangedWeaponTargeting(ETargetingSource Source = ETargetingSource::CameraTowardsFocus);
+
+	// Fires at the weapon's RoundsPerMinute until StopAutomaticFire or the end of the ability, instead of reactivating once per frame.
+	// Time is accumulated every frame and each attack that came due gets its own timestamp, seed and heat step,
+	// the attacks of a frame are sent to the server in one target data. Only runs where the ability is locally controlled
+	UFUNCTION(BlueprintCallable)
+		void StartAutomaticFire(ETargetingSource Source = ETargetingSource::CameraTowardsFocus);
+
+	UFUNCTION(BlueprintCallable)
+		void StopAutomaticFire();
+
+	// Commits the attack and launches one projectile of the weapon's ProjectileDefinition per pellet from the source.
+	// Only runs where the ability is locally controlled, a client sends its origin and aim and the server launches the damaging volley from them.
+	// The server multicasts the volley so the other clients see it
+	UFUNCTION(BlueprintCallable)
+		void FireProjectiles(ETargetingSource Source = ETargetingSource::WeaponTowardsFocus);
+
 	UFUNCTION(BlueprintCallable)
 		FTransform GetTargetingTransform(ETargetingSource source);
-	
+
+	// Directions of the HitsPerAttack pellets of this attack, sampled in the weapon spread cone from the attack seed.
+	// Trace these instead of randomizing in blueprint, the server regenerates them to check the hits
+	UFUNCTION(BlueprintCallable)
+		TArray<FVector> GeneratePelletDirections(const FVector& AimDir);
+
+	virtual void BuildWeaponHits(const TArray<FHitResult>& FoundHits, FInventoryGameplayAbilityTargetData_WeaponHits& OutWeaponHits) override;
+	virtual bool ValidateWeaponHits(FInventoryGameplayAbilityTargetData_WeaponHits& WeaponHits) override;
+
+public:
+	// appends the hits of one trace on actors not in SeenHits and adds them to it, returns the number added
+	static int32 AddTraceHits(const TArray<FHitResult>& TraceHits, FWeaponHitSet& SeenHits, TArray<FHitResult>& OutHitResults);
+
+	// seed of the current attack, derived from the activation prediction key so client and server get the same one
+	int32 GetAttackSeed() const { return GetAttackSeed(AttackIndex); }
+	int32 GetAttackSeed(int32 InAttackIndex) const;
+	static int32 GetShotSeed(int32 AttackSeed, int32 ShotIndex) { return (int32)HashCombine((uint32)AttackSeed, (uint32)ShotIndex); }
+
+	// direction in a cone of HalfAngleDegrees around AimDir, the same on every machine for the same seed
+	static FVector SampleSpreadCone(const FVector& AimDir, float HalfAngleDegrees, float Exponent, int32 Seed);
+
+private:
+	void OnPelletTraceDone(const FTraceHandle& TraceHandle, FTraceDatum& TraceDatum);
+
+	// traces the pellets of one attack from StartTrace with params prepared by InitTraceParams, and appends their hits
+	void TracePellets(const FVector& StartTrace, const TArray<FVector>& Directions, ECollisionChannel TraceChannel, const FCollisionQueryParams& TraceParams, TArray<FHitResult>& OutHits) const;
+
+	// fires the attacks that came due since the last frame and rearms itself for the next one
+	void TickAutomaticFire();
+
+	// commits the attack and launches one projectile per pellet of the cone, ends the ability if the commit fails.
+	// On the server the volley is multicast so the other clients launch a cosmetic copy
+	bool LaunchProjectiles(const FVector& Origin, const FVector& AimDir, float SpreadAngle, int32 AttackSeed);
+
+	// async pellet traces of the current attack, results with another batch id belong to an attack that was abandoned
+	uint32 PelletTraceBatch = 0;
+	int32 NumPendingPelletTraces = 0;
+	TArray<FHitResult> PendingPelletHits;
+	FWeaponHitSet PendingSeenHits;
+
+	// pellets of the attack being targeted, sent with the hits by BuildWeaponHits
+	TArray<FVector> PelletDirections;
+	FVector AttackAimDirection = FVector::ForwardVector;
+	float AttackSpreadAngle = 0.0f;
+
+	// attack of this activation being targeted and its time since the first one, sent with the hits by BuildWeaponHits
+	int32 AttackIndex = 0;
+	float AttackShotTime = 0.0f;
+
+	// automatic fire state, see StartAutomaticFire
+	FTimerHandle AutomaticFireTimer;
+	ETargetingSource AutomaticFireSource = ETargetingSource::CameraTowardsFocus;
+	bool bAutomaticFire = false;
+	double NextAttackTime = 0.0;
+
+	// server side, the attacks already accepted this activation and when it started
+	int32 LastValidatedAttackIndex = INDEX_NONE;
+	double ActivationTime = 0.0;
 };
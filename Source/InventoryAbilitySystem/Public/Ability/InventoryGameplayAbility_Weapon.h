@@ -5,6 +5,9 @@
 #include "InventoryGameplayAbility_FromEquipment.h"
 #include "InventoryGameplayAbility_Weapon.generated.h"
 
+struct FInventoryGameplayAbilityTargetData_WeaponHits;
+class UGameplayEffect;
+
 /**
  *
  */
@@ -34,6 +37,11 @@ public:
 	//~End of UGameplayAbility interface
 
 protected:
+	// Applied natively by the server to the targets of the confirmed hits, through UWeaponHitQueueSubsystem so all hits of a frame
+	// on one target are one effect. Leave empty if OnWeaponTargetDataReady applies the damage
+	UPROPERTY(EditDefaultsOnly, Category = "Damage")
+		TSubclassOf<UGameplayEffect> HitDamageEffect;
+
 	virtual void PostCommitAbility() {};
 
 	// Called when attacking and using no projectile weapons
@@ -42,10 +50,28 @@ protected:
 
 	virtual void OnTargetDataReadyCallback(const FGameplayAbilityTargetDataHandle& InData, FGameplayTag ApplicationTag);
 
+	// sends, validates and commits the target data, then hands the hits to OnWeaponTargetDataReady. Each WeaponHits entry is one shot,
+	// with bShotsCommitted the caller already committed every shot as it fired it
+	void ProcessWeaponTargetData(const FGameplayAbilityTargetDataHandle& InData, FGameplayTag ApplicationTag, bool bShotsCommitted);
+
+	// one handle per shot, a handle without WeaponHits entries is a single shot
+	static TArray<FGameplayAbilityTargetDataHandle> SplitShots(const FGameplayAbilityTargetDataHandle& TargetData);
+
+	// server only, drops the hits a client sent that don't match the lag compensated history. False if the shot itself is forged
+	virtual bool ValidateTargetData(FGameplayAbilityTargetDataHandle& TargetData);
+	// server only, checks a volley before its hits are checked one by one and may record it as accepted. May drop hits, false if the shot is forged
+	virtual bool ValidateWeaponHits(FInventoryGameplayAbilityTargetData_WeaponHits& WeaponHits) { return true; }
+
+	// packs the hits found by PerformLocalTargeting, the hit index is used as shot index
+	virtual void BuildWeaponHits(const TArray<FHitResult>& FoundHits, FInventoryGameplayAbilityTargetData_WeaponHits& OutWeaponHits);
+
 	// Called when target data is ready
 	UFUNCTION(BlueprintImplementableEvent)
 		void OnWeaponTargetDataReady(const FGameplayAbilityTargetDataHandle& TargetData);
 
 	UFUNCTION(BlueprintCallable)
 		void StartWeaponTargeting();
+
+	// packs the hits of an attack into target data and processes it, like StartWeaponTargeting does with the hits of PerformLocalTargeting
+	void SubmitWeaponHits(const TArray<FHitResult>& FoundHits);
 };
@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameplayEffectTypes.h"
+#include "InventoryGameplayEffectContext.generated.h"
+
+class UPhysicalMaterial;
+
+/** One pellet of a batched damage effect */
+USTRUCT()
+struct FInventoryDamageHit
+{
+	GENERATED_BODY()
+
+	FVector ImpactPoint = FVector::ZeroVector;
+	FVector ImpactNormal = FVector::ZeroVector;
+	TWeakObjectPtr<UPhysicalMaterial> PhysMaterial;
+	// from the trace start, the damage falloff of the weapon is sampled at it
+	float Distance = 0.0f;
+};
+
+/**
+ * Effect context of the damage the server applies for the hits of a frame, see UWeaponHitQueueSubsystem.
+ * Carries every hit the effect sums up, UDamageExecution attenuates each of them on its own and gameplay cues can place an impact per hit.
+ * The hit result of the base context is the first hit.
+ */
+USTRUCT()
+struct INVENTORYABILITYSYSTEM_API FInventoryGameplayEffectContext : public FGameplayEffectContext
+{
+	GENERATED_BODY()
+
+	// hits past this are not sent to clients, the server still sums the damage of all of them
+	static constexpr int32 MaxHits = 255;
+
+	FInventoryGameplayEffectContext()
+		: FGameplayEffectContext()
+	{
+	}
+
+	FInventoryGameplayEffectContext(AActor* InInstigator, AActor* InEffectCauser)
+		: FGameplayEffectContext(InInstigator, InEffectCauser)
+	{
+	}
+
+	TArray<FInventoryDamageHit> Hits;
+
+	void AddDamageHit(const FHitResult& Hit);
+
+	// the context of the handle if it is one of these
+	static const FInventoryGameplayEffectContext* ExtractEffectContext(const FGameplayEffectContextHandle& Handle);
+
+	//~FGameplayEffectContext interface
+	virtual FGameplayEffectContext* Duplicate() const override;
+	virtual UScriptStruct* GetScriptStruct() const override { return StaticStruct(); }
+	virtual bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess) override;
+	//~End of FGameplayEffectContext interface
+};
+
+template<>
+struct TStructOpsTypeTraits<FInventoryGameplayEffectContext> : public TStructOpsTypeTraitsBase2<FInventoryGameplayEffectContext>
+{
+	enum
+	{
+		WithNetSerializer = true,
+		WithCopy = true
+	};
+};
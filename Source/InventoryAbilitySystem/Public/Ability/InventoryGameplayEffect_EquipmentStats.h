@@ -0,0 +1,28 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameplayEffect.h"
+#include "InventoryGameplayEffect_EquipmentStats.generated.h"
+
+/**
+ * UInventoryGameplayEffect_EquipmentStats
+ *
+ *	Infinite effect applied once per pawn by UEquipmentComponent, its SetByCaller magnitudes are the summed item stats of the equipped items.
+ *	Each modifier reads the SetByCaller tag that is also the item stat tag, subclasses can add modifiers for more stats.
+ */
+UCLASS()
+class INVENTORYABILITYSYSTEM_API UInventoryGameplayEffect_EquipmentStats : public UGameplayEffect
+{
+	GENERATED_BODY()
+
+public:
+	UInventoryGameplayEffect_EquipmentStats(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
+
+	// SetByCaller tags of the modifiers, these are the item stats that get summed
+	void GetStatTags(TArray<FGameplayTag>& OutStatTags) const;
+
+protected:
+	void AddStatModifier(const FGameplayAttribute& Attribute, FGameplayTag StatTag);
+};
@@ -0,0 +1,90 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Containers/StaticArray.h"
+#include "UObject/ObjectKey.h"
+#include "LagCompensationSubsystem.generated.h"
+
+class UCapsuleComponent;
+
+/** Outcome of checking a client hit against the recorded history */
+enum class ELagCompensatedHit : uint8
+{
+	Valid,
+	// the trace doesn't start near where the shooter was at the rewind time, the whole shot is forged
+	InvalidOrigin,
+	// the impact is not on the target where it was at the rewind time, or beyond the range of the weapon
+	OutOfReach,
+	// static geometry is between the trace start and the target
+	Occluded
+};
+
+/**
+ * Server side history of the collision capsules of the registered pawns, used to validate the hits clients send.
+ * One frame is recorded per LagCompensation.RecordInterval into a ring of NumFrames, a hit is checked against
+ * the capsule interpolated at the time the client fired plus one bounded trace against static geometry.
+ * A pawn costs NumFrames * 16 bytes of history (~55KB for 100 pawns) and one capsule read per recorded frame.
+ */
+UCLASS()
+class INVENTORYABILITYSYSTEM_API ULagCompensationSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// frames kept per pawn, 32 frames at 60Hz cover a bit more than half a second
+	static constexpr int32 NumFrames = 32;
+
+	//~FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~End of FTickableGameObject interface
+
+	/** Starts recording the pawn, only on the server */
+	void RegisterPawn(APawn* Pawn);
+	void UnregisterPawn(APawn* Pawn);
+
+	/** Server time the controller saw the world at when it fired, clamped to LagCompensation.MaxRewindTime */
+	double GetRewindTime(const AController* Shooter) const;
+
+	/** Collision capsule of the pawn interpolated at Time, false if the actor isn't recorded */
+	bool GetHistoricCapsule(const AActor* Actor, double Time, FVector& OutCenter, float& OutRadius, float& OutHalfHeight) const;
+
+	/** True if a trace the shooter claims to have started at TraceStart is near where it was at Time */
+	bool IsValidOrigin(const FVector& TraceStart, const AActor* Shooter, double Time) const;
+
+	/** Checks a hit claimed by the shooter against the history at Time, MaxRange 0 doesn't limit the range.
+	 * Hits on actors that aren't recorded skip the capsule check but still get the origin, range and occlusion checks */
+	ELagCompensatedHit ValidateHit(const FHitResult& Hit, const AActor* Shooter, double Time, float MaxRange = 0.0f) const;
+
+	int32 GetNumPawns() const { return Histories.Num(); }
+
+	// counters since the world started, dumped with LagCompensation.Stats
+	mutable int32 NumHitsValidated = 0;
+	mutable int32 NumHitsRejected = 0;
+
+private:
+	struct FPawnHistory
+	{
+		TWeakObjectPtr<APawn> Pawn;
+		// key in HistoryIndex, still usable once the pawn is gone
+		TObjectKey<AActor> Key;
+		// read every frame if the root is a capsule, otherwise the collision cylinder taken at registration is kept
+		TWeakObjectPtr<UCapsuleComponent> Capsule;
+		float Radius = 0.0f;
+		float HalfHeight = 0.0f;
+		// xyz center, w half height, indexed like FrameTimes
+		TStaticArray<FVector4f, NumFrames> Samples;
+	};
+
+	FVector4f SamplePawn(FPawnHistory& History) const;
+
+	TArray<FPawnHistory> Histories;
+	TMap<TObjectKey<AActor>, int32> HistoryIndex;
+
+	TStaticArray<double, NumFrames> FrameTimes;
+	int32 NewestFrame = 0;
+	int32 NumRecordedFrames = 0;
+};
@@ -0,0 +1,57 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Templates/SubclassOf.h"
+#include "WeaponHitQueueSubsystem.generated.h"
+
+class UAbilitySystemComponent;
+class UGameplayAbility;
+class UGameplayEffect;
+class UWeaponInstance;
+
+/**
+ * Server side queue of confirmed weapon hits, applied once per frame.
+ * The hits of a frame are grouped by source, target, weapon, effect, ability and level, and every group is applied as one damage effect
+ * whose FInventoryGameplayEffectContext lists the hits. The source attributes are captured and the target health changes
+ * once per group instead of once per pellet.
+ */
+UCLASS()
+class INVENTORYABILITYSYSTEM_API UWeaponHitQueueSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//~FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~End of FTickableGameObject interface
+
+	/** Queues a hit of the source on the actor hit, hits on actors without an ability system are dropped. Server only */
+	void QueueHit(UAbilitySystemComponent* Source, const UGameplayAbility* Ability, UWeaponInstance* Weapon, TSubclassOf<UGameplayEffect> DamageEffect, float Level, const FHitResult& Hit);
+
+	/** Applies the queued hits now */
+	void Flush();
+
+	int32 GetNumQueuedHits() const { return QueuedHits.Num(); }
+
+	// counters since the world started, dumped with Inventory.Weapon.HitQueueStats
+	int32 NumHitsApplied = 0;
+	int32 NumEffectsApplied = 0;
+
+private:
+	struct FQueuedHit
+	{
+		TWeakObjectPtr<UAbilitySystemComponent> Source;
+		TWeakObjectPtr<UAbilitySystemComponent> Target;
+		TWeakObjectPtr<const UGameplayAbility> Ability;
+		TWeakObjectPtr<UWeaponInstance> Weapon;
+		TSubclassOf<UGameplayEffect> DamageEffect;
+		float Level = 1.0f;
+		FHitResult Hit;
+	};
+
+	TArray<FQueuedHit> QueuedHits;
+};
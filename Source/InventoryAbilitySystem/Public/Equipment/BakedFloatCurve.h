@@ -0,0 +1,56 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FRichCurve;
+
+/**
+ * A float curve sampled into a uniform lookup table, evaluation is a clamp, two loads and a lerp.
+ * The sample count is doubled until the error against the source curve is within MaxError or MaxSamples is reached.
+ * Outside of the key range the first/last value is returned (constant extrapolation).
+ */
+struct INVENTORYABILITYSYSTEM_API FBakedFloatCurve
+{
+public:
+	void Bake(const FRichCurve& Curve, int32 MaxSamples, float MaxError);
+	void Reset();
+
+	bool IsBaked() const { return Samples.Num() > 0; }
+
+	FORCEINLINE float Eval(float Time) const
+	{
+		checkSlow(IsBaked());
+
+		const float Position = FMath::Clamp((Time - MinTime) * InvStep, 0.0f, LastSample);
+		const int32 Index = FMath::Min((int32)Position, Samples.Num() - 2);
+		if (Index < 0)
+		{
+			// single sample, the curve is flat
+			return Samples[0];
+		}
+		return FMath::Lerp(Samples[Index], Samples[Index + 1], Position - Index);
+	}
+
+	void GetTimeRange(float& OutMinTime, float& OutMaxTime) const { OutMinTime = MinTime; OutMaxTime = MaxTime; }
+	void GetValueRange(float& OutMinValue, float& OutMaxValue) const { OutMinValue = MinValue; OutMaxValue = MaxValue; }
+
+	int32 GetNumSamples() const { return Samples.Num(); }
+
+	/** Largest difference to the source curve measured while baking */
+	float GetBakedError() const { return BakedError; }
+
+private:
+	TArray<float> Samples;
+
+	float MinTime = 0.0f;
+	float MaxTime = 0.0f;
+	float InvStep = 0.0f;
+	float LastSample = 0.0f;
+
+	float MinValue = 0.0f;
+	float MaxValue = 0.0f;
+
+	float BakedError = 0.0f;
+};
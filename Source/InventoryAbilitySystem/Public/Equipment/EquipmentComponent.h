@@ -6,12 +6,27 @@
 #include "Components/ActorComponent.h"
 #include "Ability/AbilitySet.h"
 #include "Net/Serialization/FastArraySerializer.h"
+#include "ActiveGameplayEffectHandle.h"
+#include "Containers/StaticArray.h"
+#include "Engine/NetSerialization.h"
 #include "EquipmentComponent.generated.h"
 
 class UInventoryItemInstance;
+class UInventoryFragment_EquippableItem;
+class UEquipmentComponent;
+class UProjectileDefinition;
+struct FStreamableHandle;
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FEquipEvent, UEquipmentInstance*, NewEquipment);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FWeaponChangedEvent, int32, NewSlotIndex);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FEquipBatchEvent, const TArray<UEquipmentInstance*>&, NewEquipment);
+
+// item to put into a slot by UEquipmentComponent::ApplyLoadout
+struct FEquipmentLoadoutEntry
+{
+	int32 SlotId = 0;
+	TObjectPtr<UInventoryItemInstance> Item = nullptr;
+};
 
 USTRUCT(BlueprintType)
 struct INVENTORYABILITYSYSTEM_API FSlotsChangedMessage
@@ -47,6 +62,7 @@ struct INVENTORYABILITYSYSTEM_API FAppliedEquipmentEntry : public FFastArraySeri
 
 private:
 	friend UEquipmentComponent;
+	friend struct FEquipmentList;
 
 	UPROPERTY()
 		TSubclassOf<UEquipmentDefinition> equipmentDefinition;
@@ -54,6 +70,120 @@ private:
 		TObjectPtr<UEquipmentInstance> instance = nullptr;
 	UPROPERTY(NotReplicated)
 		FAbilitySet_GrantedHandles grantedHandles;
+	// abilities stay granted but the instance is not active
+	UPROPERTY()
+		bool bDormant = false;
+
+	// client only, whether OnEquipped ran locally, the instance might resolve after the entry was added
+	bool bEquippedLocally = false;
+
+	// instance the entry is listed under in FEquipmentList::instancesByClass
+	UEquipmentInstance* indexedInstance = nullptr;
+};
+
+/**
+ * Delta replicated list of the applied equipment, clients run OnEquipped/OnUnequipped from the replication callbacks
+ */
+USTRUCT(BlueprintType)
+struct INVENTORYABILITYSYSTEM_API FEquipmentList : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+		FEquipmentList()
+		: ownerComponent(nullptr)
+	{}
+
+	FEquipmentList(UEquipmentComponent* inOwnerComponent)
+		: ownerComponent(inOwnerComponent)
+	{}
+
+	// creates the instance, grants the ability sets and spawns the actors (authority only)
+	UEquipmentInstance* AddEntry(TSubclassOf<UEquipmentDefinition> EquipmentDefinition, bool bDormant = false);
+	// takes the ability sets, destroys the actors and removes the entry (authority only)
+	void RemoveEntry(UEquipmentInstance* Instance);
+	// replicates the dormant state of the instance, clients run OnEquipped/OnUnequipped for it
+	void SetEntryDormant(UEquipmentInstance* Instance, bool bDormant);
+	// client only, runs OnEquipped/OnUnequipped ahead of the server for a predicted weapon switch
+	void PredictEntryDormant(UEquipmentInstance* Instance, bool bDormant);
+	// client only, brings every entry back to its replicated dormant state
+	void ReconcileLocally();
+
+	//~FFastArraySerializer contract
+	void PreReplicatedRemove(const TArrayView<int32> RemovedIndices, int32 FinalSize);
+	void PostReplicatedAdd(const TArrayView<int32> AddedIndices, int32 FinalSize);
+	void PostReplicatedChange(const TArrayView<int32> ChangedIndices, int32 FinalSize);
+	//~End of FFastArraySerializer contract
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+	{
+		return FFastArraySerializer::FastArrayDeltaSerialize<FAppliedEquipmentEntry, FEquipmentList>(Entries, DeltaParms, *this);
+	}
+
+	// instances of the class or a class deriving from it, in equip order
+	TConstArrayView<UEquipmentInstance*> GetInstancesOfType(const UClass* InstanceType) const
+	{
+		const TArray<UEquipmentInstance*>* Instances = instancesByClass.Find(InstanceType);
+		return Instances ? TConstArrayView<UEquipmentInstance*>(*Instances) : TConstArrayView<UEquipmentInstance*>();
+	}
+
+private:
+	friend UEquipmentComponent;
+
+	class UInventoryAbilitySystemComponent* GetAbilitySystemComponent() const;
+	void EquipLocally(FAppliedEquipmentEntry& Entry);
+	void EquipLocally(FAppliedEquipmentEntry& Entry, bool bDormant);
+	// lists the entry under its instance class and every parent class up to UEquipmentInstance
+	void UpdateIndex(FAppliedEquipmentEntry& Entry);
+	void RemoveFromIndex(FAppliedEquipmentEntry& Entry);
+
+	// Replicated list of equipment entries
+	UPROPERTY()
+		TArray<FAppliedEquipmentEntry> Entries;
+
+	UPROPERTY(NotReplicated)
+		TObjectPtr<UEquipmentComponent> ownerComponent;
+
+	// the instances are kept alive by Entries
+	TMap<const UClass*, TArray<UEquipmentInstance*>> instancesByClass;
+};
+
+template<>
+struct TStructOpsTypeTraits<FEquipmentList> : public TStructOpsTypeTraitsBase2<FEquipmentList>
+{
+	enum { WithNetDeltaSerializer = true };
+};
+
+// active weapon slot as confirmed by the server, with the last client switch the server processed
+USTRUCT()
+struct FReplicatedWeaponSlot
+{
+	GENERATED_BODY()
+
+		FReplicatedWeaponSlot()
+	{}
+
+	UPROPERTY()
+		int32 SlotIndex = INDEX_NONE;
+
+	// id of the last ServerSetActiveSlotIndex, the owning client ignores the slot while a newer switch is in flight
+	UPROPERTY()
+		uint8 SwitchId = 0;
+};
+
+USTRUCT(BlueprintType)
+struct INVENTORYABILITYSYSTEM_API FEquipmentCategoryConfig
+{
+	GENERATED_BODY()
+
+		FEquipmentCategoryConfig()
+	{}
+
+	// fragment class of the category, fragments deriving from it share its slots
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Equipment)
+		TSubclassOf<UInventoryFragment_EquippableItem> Category;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Equipment, meta = (ClampMin = 1))
+		int32 NumSlots = 1;
 };
 
 USTRUCT(BlueprintType)
@@ -64,14 +194,59 @@ struct FEquipmentActorToSpawn
 		FEquipmentActorToSpawn()
 	{}
 
+	// soft so the class can be preloaded before the equip, see UEquipmentComponent::PreloadEquipment
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Equipment)
-		TSubclassOf<AActor> ActorToSpawn;
+		TSoftClassPtr<AActor> ActorToSpawn;
 
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Equipment)
 		FName AttachSocket;
 
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Equipment)
 		FTransform AttachTransform;
+
+	// false for purely visual actors, with Equipment.CosmeticPolicy 1 they are not spawned on dedicated servers and every client spawns its own unreplicated copy
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Equipment)
+		bool bGameplayRelevant = true;
+
+	// socket of the actor's meshes ranged weapons fire from, none if the actor has no muzzle. See URangedWeaponInstance::GetMuzzleTransform
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Equipment)
+		FName MuzzleSocket = FName(TEXT("Muzzle"));
+};
+
+USTRUCT(BlueprintType)
+struct FEquipmentActorPoolConfig
+{
+	GENERATED_BODY()
+
+		FEquipmentActorPoolConfig()
+	{}
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Equipment)
+		TSubclassOf<AActor> ActorClass;
+
+	// actors spawned into the pool on begin play
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Equipment, meta = (ClampMin = 0))
+		int32 WarmupCount = 1;
+
+	// released actors above this count are destroyed instead of parked
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Equipment, meta = (ClampMin = 0))
+		int32 MaxPooled = 2;
+};
+
+// parked equipment actors of one class
+USTRUCT()
+struct FEquipmentActorPool
+{
+	GENERATED_BODY()
+
+		FEquipmentActorPool()
+	{}
+
+	UPROPERTY()
+		TArray<TObjectPtr<AActor>> Actors;
+
+	// world time the actors were parked at, parallel to Actors (oldest first)
+	TArray<double> ParkTimes;
 };
 
 UCLASS(Blueprintable, Const, Abstract, BlueprintType)
@@ -93,6 +268,9 @@ public:
 	// Actors to spawn on the pawn when this is equipped
 	UPROPERTY(EditDefaultsOnly, Category = Equipment)
 		TArray<FEquipmentActorToSpawn> ActorsToSpawn;
+
+	// collects the soft referenced assets equipping this needs, including the ones of the instance type
+	void GatherAssetsToLoad(TArray<FSoftObjectPath>& OutAssets) const;
 };
 
 UCLASS(ClassGroup = (Custom), meta = (BlueprintSpawnableComponent))
@@ -101,27 +279,113 @@ class INVENTORYABILITYSYSTEM_API UEquipmentComponent : public UActorComponent
 	GENERATED_BODY()
 
 private:
-	UPROPERTY(VisibleAnywhere)
-		TArray<FAppliedEquipmentEntry> equipmentList;
+	friend struct FEquipmentList;
+
+	UPROPERTY(VisibleAnywhere, Replicated)
+		FEquipmentList equipmentList;
 	TObjectPtr<UEquipmentInstance> equippedWeapon;
-	TArray<TArray<TObjectPtr<UEquipmentInstance>>> equippedItems;
+	// flat slot table, parallel to equipmentSlots
+	TArray<TObjectPtr<UEquipmentInstance>> equippedItems;
 
 protected:
 	/* number of weapon slots */
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, meta = (ClampMin = 1, ClampMax = 32))
 		int32 numWeaponSlots = 2;
 
+	/* slot layout of the non weapon categories, the slot table is sized from it on initialization */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
+		TArray<FEquipmentCategoryConfig> equipmentCategoryConfig;
+
+	/* number of slots a category gets if it is not part of equipmentCategoryConfig */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, meta = (ClampMin = 1))
+		int32 defaultCategorySlots = 4;
+
 	TArray<TSubclassOf<UInventoryFragment_EquippableItem>> equipmentCategories;
-	TArray<TArray<TObjectPtr<UInventoryItemInstance>>> equipmentSlots;
+	// first slot and number of slots of each category in the flat slot table
+	TArray<int32> categorySlotOffsets;
+	TArray<int32> categorySlotCounts;
+	// fragment class -> category id, resolved once per fragment class
+	TMap<TSubclassOf<UInventoryFragment_EquippableItem>, int32> categoryIds;
+	// flat slot table indexed by categorySlotOffsets[categoryId] + slotId
+	TArray<TObjectPtr<UInventoryItemInstance>> equipmentSlots;
 	TArray<TObjectPtr<UInventoryItemInstance>> weaponSlots;
 	int32 activeSlotIndex = -1;
 
+	// body slots taken by the items in equipmentSlots, see UInventoryFragment_BodySlots::GetSlotMask
+	uint32 occupiedBodySlots = 0;
+	// item taking each body slot bit and its index in equipmentSlots, so a conflict resolves to its slot without a search
+	TStaticArray<TObjectPtr<UInventoryItemInstance>, 16> bodySlotItems;
+	TStaticArray<int32, 16> bodySlotIndices;
+
+	// item instances don't replicate, the owning client cycles over this bitmask of filled weapon slots
+	UPROPERTY(Replicated)
+		int32 occupiedWeaponSlots = 0;
+	UPROPERTY(ReplicatedUsing = OnRep_ReplicatedWeaponSlot)
+		FReplicatedWeaponSlot replicatedWeaponSlot;
+	// owning client only, id of the last switch sent to the server
+	uint8 predictedSwitchId = 0;
+
+	/* weapons in all slots stay equipped with their abilities granted, swapping only makes the old weapon dormant and wakes the new one */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
+		bool bKeepWeaponAbilitiesGranted = false;
+	// equipment of each weapon slot while bKeepWeaponAbilitiesGranted, parallel to weaponSlots
+	// replicated to the owner so it can predict the cosmetic swap
+	UPROPERTY(Replicated)
+		TArray<TObjectPtr<UEquipmentInstance>> weaponInstances;
+
+	/* pool settings per equipment actor class, weapon swaps reuse parked actors instead of spawning */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
+		TArray<FEquipmentActorPoolConfig> actorPoolConfig;
+
+	/* max parked actors of classes that are not part of actorPoolConfig */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, meta = (ClampMin = 0))
+		int32 defaultMaxPooledActors = 2;
+
+	/* parked actors unused for longer than this are destroyed, 0 keeps them until the component goes away */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, meta = (ClampMin = 0.0, ForceUnits = s))
+		float pooledActorIdleTime = 60.f;
+
+	UPROPERTY()
+		TMap<TSubclassOf<AActor>, FEquipmentActorPool> actorPools;
+	FTimerHandle actorPoolEvictionTimer;
+
+	/* weapon swaps wait for a running preload of the weapon instead of loading its assets synchronously */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
+		bool bDeferEquipUntilLoaded = true;
+
+	// running and finished preloads, kept so the assets stay resident
+	TMap<TSubclassOf<UEquipmentDefinition>, TSharedPtr<FStreamableHandle>> preloadHandles;
+	// definitions whose assets are held by a finished handle in preloadHandles, equips don't check their assets again
+	TSet<TSubclassOf<UEquipmentDefinition>> residentDefinitions;
+	// weapon slot waiting for its preload to finish
+	int32 pendingWeaponSlot = INDEX_NONE;
+	// loadout waiting for the preloads of its equipment, parallel arrays of slot and item
+	bool bLoadoutPending = false;
+	TArray<int32> pendingLoadoutSlots;
+	UPROPERTY()
+		TArray<TObjectPtr<UInventoryItemInstance>> pendingLoadoutItems;
+
+	/* infinite effect carrying the summed item stats of the non weapon slots, one per pawn and updated in place when gear changes */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
+		TSubclassOf<class UInventoryGameplayEffect_EquipmentStats> equipmentStatEffect;
+
+	FActiveGameplayEffectHandle equipmentStatHandle;
+	// stat tag -> magnitude last applied with equipmentStatEffect
+	TMap<FGameplayTag, float> equipmentStatMagnitudes;
+
+	// while set, equips skip their actors, OnEquipped and OnEquip until EndEquipBatch
+	bool bBatchingEquips = false;
+	TArray<TObjectPtr<UEquipmentInstance>> batchedEquips;
+
 public:
 	UEquipmentComponent(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
 
-	// Called every frame
-	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+	virtual void InitializeComponent() override;
 	virtual void UninitializeComponent() override;
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual bool ReplicateSubobjects(class UActorChannel* Channel, class FOutBunch* Bunch, FReplicationFlags* RepFlags) override;
+	virtual void ReadyForReplication() override;
 
 	UPROPERTY(BlueprintAssignable)
 		FEquipEvent OnEquip;
@@ -129,6 +393,10 @@ public:
 	UPROPERTY(BlueprintAssignable)
 		FEquipEvent OnUnequip;
 
+	/* broadcast once for all equipment of an ApplyLoadout, OnEquip is not broadcast for them */
+	UPROPERTY(BlueprintAssignable)
+		FEquipBatchEvent OnEquipBatch;
+
 	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly)
 		UEquipmentInstance* EquipItemDefinition(TSubclassOf<UEquipmentDefinition> EquipmentDefinition);
 
@@ -151,23 +419,72 @@ public:
 	UFUNCTION(BlueprintCallable, BlueprintPure, meta = (DeterminesOutputType = InstanceType))
 		TArray<UEquipmentInstance*> GetEquipmentInstancesOfType(TSubclassOf<UEquipmentInstance> InstanceType) const;
 
+	/** Same as GetEquipmentInstancesOfType without copying, the view is invalidated by the next equip or unequip */
+	TConstArrayView<UEquipmentInstance*> GetInstancesOfType(TSubclassOf<UEquipmentInstance> InstanceType) const { return equipmentList.GetInstancesOfType(InstanceType); }
+
+	template <typename T>
+	T* GetFirstInstanceOfType() const
+	{
+		TConstArrayView<UEquipmentInstance*> Instances = equipmentList.GetInstancesOfType(T::StaticClass());
+		return Instances.Num() > 0 ? CastChecked<T>(Instances[0]) : nullptr;
+	}
+
+	// calls Func(T*) for every equipped instance of T, Func must not equip or unequip
+	template <typename T, typename FuncType>
+	void ForEachInstanceOfType(FuncType&& Func) const
+	{
+		for (UEquipmentInstance* Instance : equipmentList.GetInstancesOfType(T::StaticClass()))
+		{
+			Func(CastChecked<T>(Instance));
+		}
+	}
+
 	UFUNCTION(BlueprintPure)
 		TArray<UInventoryItemInstance*> GetSlots(TSubclassOf<UInventoryFragment_EquippableItem> type) const;
 	UFUNCTION(BlueprintPure)
 		UInventoryItemInstance* GetCurrentWeapon() {
-		if (activeSlotIndex >= 0) return weaponSlots[activeSlotIndex];
+		if (weaponSlots.IsValidIndex(activeSlotIndex)) return weaponSlots[activeSlotIndex];
 		else return nullptr;
 	}
 
 	UFUNCTION(BlueprintPure)
 		int32 GetNextFreeWeaponSlot();
 
+	// true if the item is in a weapon or equipment slot
+	bool IsItemInSlot(const UInventoryItemInstance* item) const;
+
+	/* server only, the other clients launch a cosmetic copy of the volley the pawn fired, the pellets are regenerated from the seed
+	* the shooter and the server simulate their own
+	*/
+	UFUNCTION(NetMulticast, Unreliable)
+		void MulticastProjectileVolley(const UProjectileDefinition* definition, FVector_NetQuantize origin, FVector_NetQuantizeNormal aimDirection, float spreadAngle, float spreadExponent, uint8 numPellets, int32 seed);
+
+	UFUNCTION(BlueprintPure)
+		int32 GetOccupiedBodySlots() const { return (int32)occupiedBodySlots; }
+
+	/* true if equipping the item doesn't take off another item, items without body slots never conflict */
+	UFUNCTION(BlueprintPure)
+		bool CanEquipWithoutConflict(const UInventoryItemInstance* item) const;
+
+	/* items EquipItemInstance would take off to make room for the item */
+	UFUNCTION(BlueprintCallable)
+		void GetBodySlotConflicts(const UInventoryItemInstance* item, TArray<UInventoryItemInstance*>& outConflicts) const;
+
+	/* slot of the items category to put it into: the slot of an item it replaces, else the first free one, INDEX_NONE if the category is full */
+	UFUNCTION(BlueprintPure)
+		int32 FindSlotForItem(const UInventoryItemInstance* item) const;
+
 	/* also equips item (exception are weapons, to keep current weapon active
 	* for weapons use SetActiveSlotIndex, CycleActiveSlotForward and CycleActiveSlotBackward
 	*/
 	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly)
 		void AddItemToSlot(int32 slotId, UInventoryItemInstance* item);
 
+	/* makes the slots match the loadout in one batch: items already in their slot are skipped, slotted items the loadout doesn't list are taken off
+	* equipment that isn't resident is preloaded first and the loadout applied once it completed, the actors of all equipment are spawned after the abilities are granted and OnEquipBatch fires once
+	*/
+	void ApplyLoadout(TConstArrayView<FEquipmentLoadoutEntry> loadout);
+
 	/* removes and unequips the item in slot */
 	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly)
 		UInventoryItemInstance* RemoveItemFromSlot(int32 slotId, TSubclassOf<UInventoryFragment_EquippableItem> type);
@@ -175,20 +492,88 @@ public:
 	UPROPERTY(BlueprintAssignable)
 		FWeaponChangedEvent OnWeaponSlotChanged;
 
+	/* sums the item stats of the equipped items and updates the stat effect, call after changing stats of an equipped item */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly)
+		void RefreshEquipmentStats();
+
 	UFUNCTION(BlueprintPure)
 		int32 GetActiveSlotIndex() { return activeSlotIndex; }
-	/* sets new active weapon slot and updates equipment */
+	/* sets new active weapon slot and updates equipment
+	* on the owning client the switch is predicted and sent to the server, which confirms it through the replicated slot
+	*/
 	UFUNCTION(BlueprintCallable)
 		void SetActiveSlotIndex(int32 newId);
 
+	UFUNCTION(BlueprintPure)
+		bool IsWeaponSlotOccupied(int32 slotId) const { return slotId >= 0 && slotId < 32 && (occupiedWeaponSlots & (1 << slotId)) != 0; }
+
 	UFUNCTION(BlueprintCallable)
 		void CycleActiveSlotForward();
 
 	UFUNCTION(BlueprintCallable)
 		void CycleActiveSlotBackward();
 
+	// starts loading the assets of the definition, equipping it later doesn't hitch on them
+	void PreloadEquipment(TSubclassOf<UEquipmentDefinition> EquipmentDefinition);
+	// preloads the equipment of an item, called when it enters the inventory or a slot
+	void PreloadItem(UInventoryItemInstance* item);
+	// true once the assets of the definition were loaded and are kept resident by this component
+	bool IsEquipmentResident(TSubclassOf<UEquipmentDefinition> EquipmentDefinition) const;
+	bool IsPreloadInProgress(TSubclassOf<UEquipmentDefinition> EquipmentDefinition) const;
+
+	// takes a parked actor of the class or spawns one and attaches it to AttachTarget (authority only)
+	AActor* AcquireEquipmentActor(const FEquipmentActorToSpawn& SpawnInfo, USceneComponent* AttachTarget);
+	// detaches, hides and parks the actor, it is destroyed if the pool of its class is full
+	void ReleaseEquipmentActor(AActor* Actor);
+
 private:
 	class UInventoryAbilitySystemComponent* GetAbilitySystemComponent() const;
+	int32 AddCategory(TSubclassOf<UInventoryFragment_EquippableItem> category, int32 numSlots);
+	int32 FindCategoryId(TSubclassOf<UInventoryFragment_EquippableItem> fragmentClass) const;
+	int32 FindOrAddCategoryId(TSubclassOf<UInventoryFragment_EquippableItem> fragmentClass);
+	// returns the index into the flat slot table or INDEX_NONE if slotId is out of the category range
+	int32 GetSlotIndex(int32 categoryId, int32 slotId) const;
 	void EquipWeaponInSlot();
 	void UnequipWeaponInSlot();
+
+	UEquipmentInstance* EquipItemDefinition_Internal(TSubclassOf<UEquipmentDefinition> EquipmentDefinition, bool bDormant);
+	// equips the weapon dormant into weaponInstances
+	void EquipDormantWeapon(int32 slotId, UInventoryItemInstance* item);
+	void SetEquipmentDormant(UEquipmentInstance* ItemInstance, bool bDormant);
+
+	void OnPreloadCompleted(TSubclassOf<UEquipmentDefinition> EquipmentDefinition);
+	// loads the assets of the definition that are still missing in one synchronous request, the fallback of an equip that wasn't preloaded
+	void LoadEquipmentNow(TSubclassOf<UEquipmentDefinition> EquipmentDefinition);
+
+	// unequips the item in the flat slot table and frees its body slots, without bRefreshStats the caller refreshes the stats once for several removals
+	UInventoryItemInstance* RemoveItemAtSlotIndex(int32 slotIndex, bool bRefreshStats = true);
+	void OccupyBodySlots(UInventoryItemInstance* item, int32 slotIndex);
+	void FreeBodySlots(const UInventoryItemInstance* item);
+
+	// returns the item currently in the slot of the items category
+	UInventoryItemInstance* GetItemInSlot(int32 slotId, const UInventoryFragment_EquippableItem* EquipInfo) const;
+	// applies the loadout stored by ApplyLoadout, its assets are expected to be resident
+	void ApplyPendingLoadout();
+	bool IsPendingLoadoutLoading() const;
+	void BeginEquipBatch();
+	void EndEquipBatch();
+
+	UFUNCTION(Server, Reliable)
+		void ServerSetActiveSlotIndex(int32 newId, uint8 switchId);
+	UFUNCTION()
+		void OnRep_ReplicatedWeaponSlot();
+	// authority only, swaps the equipped weapon and updates the replicated slot
+	void SetActiveSlotIndex_Internal(int32 newId);
+	// owning client only, switches the slot and the cosmetics of the dormant weapons ahead of the server
+	void PredictActiveSlotIndex(int32 newId);
+	void UpdateOccupiedWeaponSlots();
+	bool IsLocallyControlled() const;
+	bool IsPredictingWeaponSwitch() const;
+	UEquipmentInstance* GetWeaponInstance(int32 slotId) const { return weaponInstances.IsValidIndex(slotId) ? weaponInstances[slotId] : nullptr; }
+
+	AActor* SpawnPooledActor(TSubclassOf<AActor> actorClass);
+	int32 GetMaxPooledActors(TSubclassOf<AActor> actorClass) const;
+	void WarmupActorPools();
+	void EvictIdlePooledActors();
+	void DestroyActorPools();
 };
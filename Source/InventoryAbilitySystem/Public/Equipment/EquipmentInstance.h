@@ -7,6 +7,8 @@
 #include "GameplayTagContainer.h"
 #include "EquipmentInstance.generated.h"
 
+class UEquipmentDefinition;
+
 USTRUCT(BlueprintType)
 struct FInventoryAnimLayerSelectionEntry
 {
@@ -14,7 +16,7 @@ struct FInventoryAnimLayerSelectionEntry
 
 	// Layer to apply if the tag matches
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
-		TSubclassOf<UAnimInstance> Layer;
+		TSoftClassPtr<UAnimInstance> Layer;
 
 	// Cosmetic tags required (all of these must be present to be considered a match)
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (Categories = "Cosmetic"))
@@ -32,32 +34,89 @@ struct FInventoryAnimLayerSelectionSet
 
 	// The layer to use if none of the LayerRules matches
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
-		TSubclassOf<UAnimInstance> DefaultLayer;
+		TSoftClassPtr<UAnimInstance> DefaultLayer;
 
-	// Choose the best layer given the rules
+	// Choose the best layer given the rules, loads it synchronously if it wasn't preloaded
 	TSubclassOf<UAnimInstance> SelectBestLayer(const FGameplayTagContainer& CosmeticTags) const;
+
+	// index of the first matching rule or INDEX_NONE for the default layer
+	int32 SelectBestRule(const FGameplayTagContainer& CosmeticTags) const;
+	TSubclassOf<UAnimInstance> GetRuleLayer(int32 RuleIndex) const;
+
+	void GatherAssetsToLoad(TArray<FSoftObjectPath>& OutAssets) const;
+};
+
+/** Counters of the equip asset pipeline, see UEquipmentComponent::PreloadEquipment. Dumped with Equipment.PreloadStats */
+struct INVENTORYABILITYSYSTEM_API FEquipmentPreloadStats
+{
+	// preloads requested through the streamable manager
+	int32 NumPreloadsStarted = 0;
+	// equips that found all their assets resident
+	int32 NumEquipsResident = 0;
+	// weapon equips that waited for a running preload
+	int32 NumEquipsDeferred = 0;
+	// assets that had to be loaded synchronously
+	int32 NumSyncLoads = 0;
+
+	static FEquipmentPreloadStats& Get();
+
+	// loads the asset synchronously if it is not resident yet and counts it
+	template<typename T>
+	static T* Resolve(const TSoftObjectPtr<T>& Asset)
+	{
+		if (Asset.IsNull())
+			return nullptr;
+		if (T* Loaded = Asset.Get())
+			return Loaded;
+		Get().NumSyncLoads++;
+		return Asset.LoadSynchronous();
+	}
+
+	template<typename T>
+	static TSubclassOf<T> Resolve(const TSoftClassPtr<T>& Class)
+	{
+		if (Class.IsNull())
+			return nullptr;
+		if (UClass* Loaded = Class.Get())
+			return Loaded;
+		Get().NumSyncLoads++;
+		return Class.LoadSynchronous();
+	}
 };
 
 UCLASS(BlueprintType, Blueprintable)
 class INVENTORYABILITYSYSTEM_API UEquipmentInstance : public UObject
 {
 	GENERATED_BODY()
+	friend class UEquipmentTickSubsystem;
 
 private:
 	UPROPERTY(ReplicatedUsing = OnRep_Instigator)
 		TObjectPtr<UObject> Instigator;
-	UPROPERTY(Replicated)
+	UPROPERTY(ReplicatedUsing = OnRep_SpawnedActors)
 		TArray<TObjectPtr<AActor>> SpawnedActors;
+	// definition this was equipped from, clients need it to spawn the cosmetic actors
+	UPROPERTY(Replicated)
+		TSubclassOf<UEquipmentDefinition> EquipmentDefinition;
+	// actors not flagged bGameplayRelevant, spawned by every machine that runs cosmetics and never replicated
+	UPROPERTY(Transient)
+		TArray<TObjectPtr<AActor>> CosmeticActors;
 
 	double TimeLastEquipped = 0.0;
 	double TimeLastUsed = 0.0;
 
+	// registered with the UEquipmentTickSubsystem
+	bool bTickRegistered = false;
+
+	// equipped with its abilities granted but not active, see UEquipmentComponent::bKeepWeaponAbilitiesGranted
+	bool bDormant = false;
+
 protected:
 	UPROPERTY(EditAnywhere, Category = "Animation")
-		UAnimMontage* EquipMontage;
+		TSoftObjectPtr<UAnimMontage> EquipMontage;
 
 	UPROPERTY(EditAnywhere, Category = "Animation")
-		UAnimMontage* UnequipMontage;
+		TSoftObjectPtr<UAnimMontage> UnequipMontage;
 
 	/* in case we have different layers in UInventoryCosmeticComponent, use this to filter */
 	UPROPERTY(EditAnywhere, Category = "Animation")
@@ -67,26 +126,78 @@ protected:
 	UPROPERTY(EditAnywhere, Category = "Animation")
 		FInventoryAnimLayerSelectionSet EquipmentLayerSet;
 
+	// layer linked by OnEquipped, OnUnequipped unlinks it without selecting again
+	UPROPERTY(Transient)
+		TSubclassOf<UAnimInstance> LinkedEquipmentLayer;
+
+	// rule of EquipmentLayerSet chosen for a cosmetic tag set
+	struct FLayerSelectionMemo
+	{
+		FGameplayTagContainer Tags;
+		int32 RuleIndex = INDEX_NONE;
+	};
+	// class default object only, cosmetic tag set hash -> chosen rule, shared by all instances of the class
+	mutable TMap<uint32, FLayerSelectionMemo> LayerSelectionMemo;
+
+	// selects the layer for the filtered cosmetic tags through the memo of the class default object
+	TSubclassOf<UAnimInstance> SelectEquipmentLayer(const struct FCosmeticTagSet& CosmeticTags) const;
+
 public:
 	UEquipmentInstance(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
-	virtual void Tick(float DeltaSecondsd) {};
+
+	// instances that return true get ticked by the UEquipmentTickSubsystem while equipped, override it together with Tick
+	virtual bool WantsTick() const { return false; }
+	virtual void Tick(float DeltaSeconds) {};
+
+	//~UObject interface
+	virtual bool IsSupportedForNetworking() const override { return true; }
+	//~End of UObject interface
 
 	UFUNCTION(BlueprintPure, Category = Equipment)
 		UObject* GetInstigator() const { return Instigator; }
 	void SetInstigator(UObject* inInstigator) { Instigator = inInstigator; }
 
 	UFUNCTION(BlueprintPure)
-		APawn* GetPawn() { return Cast<APawn>(GetOuter()); }
+		APawn* GetPawn() const { return Cast<APawn>(GetOuter()); }
 
 	UFUNCTION(BlueprintPure)
 		TArray<AActor*> GetSpawnedActors() const { return SpawnedActors; }
+	UFUNCTION(BlueprintPure)
+		TArray<AActor*> GetCosmeticActors() const { return CosmeticActors; }
+	// native access without copying the arrays
+	TConstArrayView<TObjectPtr<AActor>> GetSpawnedActorsView() const { return SpawnedActors; }
+	TConstArrayView<TObjectPtr<AActor>> GetCosmeticActorsView() const { return CosmeticActors; }
+
+	TSubclassOf<UEquipmentDefinition> GetEquipmentDefinition() const { return EquipmentDefinition; }
+	void SetEquipmentDefinition(TSubclassOf<UEquipmentDefinition> inDefinition) { EquipmentDefinition = inDefinition; }
 
+	// false on dedicated servers while Equipment.CosmeticPolicy is 1, uses the running process if there is no world context
+	static bool ShouldRunCosmetics(const UObject* WorldContextObject);
+	// true if actors not flagged bGameplayRelevant are spawned locally instead of replicated
+	static bool SpawnsCosmeticActorsLocally();
+
+	// component the equipment actors are attached to
+	USceneComponent* GetAttachTarget() const;
+
+	// spawns the gameplay relevant actors, and the cosmetic ones too if they are replicated
 	virtual void SpawnEquipmentActors(const TArray<struct FEquipmentActorToSpawn>& ActorsToSpawn);
 	virtual void DestroyEquipmentActors();
 
+	// spawns the local copies of the cosmetic actors, called from OnEquipped
+	void SpawnCosmeticActors();
+	void DestroyCosmeticActors();
+
+	UFUNCTION(BlueprintPure, Category = Equipment)
+		bool IsDormant() const { return bDormant; }
+	// hides the spawned actors while dormant, OnEquipped/OnUnequipped are called by the equipment component
+	void SetDormant(bool bInDormant);
+
 	virtual void OnEquipped();
 	virtual void OnUnequipped();
 
+	// collects the soft referenced assets OnEquipped/OnUnequipped use, called on the class default object
+	virtual void GatherAssetsToLoad(TArray<FSoftObjectPath>& OutAssets) const;
+
 	UFUNCTION(BlueprintCallable)
 		void UpdateUseTime();
 
@@ -102,7 +213,13 @@ protected:
 	UFUNCTION(BlueprintImplementableEvent, Category = Equipment, meta = (DisplayName = "OnUnequipped"))
 		void K2_OnUnequipped();
 
+protected:
+	// called when the spawned or cosmetic actors were spawned, destroyed or replicated
+	virtual void OnEquipmentActorsChanged() {}
+
 private:
 	UFUNCTION()
 		void OnRep_Instigator();
+	UFUNCTION()
+		void OnRep_SpawnedActors();
 };
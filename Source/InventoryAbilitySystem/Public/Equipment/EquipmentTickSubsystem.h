@@ -0,0 +1,46 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Equipment/RangedWeaponSimulation.h"
+#include "EquipmentTickSubsystem.generated.h"
+
+class UEquipmentInstance;
+
+/**
+ * Owns ticking of all equipped instances in the world.
+ * Only instances that override UEquipmentInstance::WantsTick get registered, the others cost nothing per frame.
+ * Ranged weapons don't tick as instances, their heat and spread is stepped in one batch by FRangedWeaponSimulation.
+ */
+UCLASS()
+class INVENTORYABILITYSYSTEM_API UEquipmentTickSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//~FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~End of FTickableGameObject interface
+
+	/** Starts ticking the instance, does nothing if it is already registered */
+	void RegisterInstance(UEquipmentInstance* Instance);
+
+	/** Stops ticking the instance */
+	void UnregisterInstance(UEquipmentInstance* Instance);
+
+	int32 GetNumActiveInstances() const { return ActiveInstances.Num(); }
+
+	FRangedWeaponSimulation& GetRangedWeaponSimulation() { return RangedWeaponSimulation; }
+
+private:
+	FRangedWeaponSimulation RangedWeaponSimulation;
+
+	// Instances that get ticked every frame, entries unregistered during the tick are null until it ends
+	UPROPERTY()
+		TArray<TObjectPtr<UEquipmentInstance>> ActiveInstances;
+
+	bool bTickingInstances = false;
+};
@@ -0,0 +1,145 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "WorldCollision.h"
+#include "ProjectileSubsystem.generated.h"
+
+class UAbilitySystemComponent;
+class UGameplayEffect;
+class UInstancedStaticMeshComponent;
+class UStaticMesh;
+class UWeaponInstance;
+
+/** Ballistics, damage and look of a projectile type, simulated by UProjectileSubsystem */
+UCLASS(BlueprintType, Const)
+class INVENTORYABILITYSYSTEM_API UProjectileDefinition : public UPrimaryDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditDefaultsOnly, Category = "Projectile", meta = (ForceUnits = "cm/s"))
+		float Speed = 5000.0f;
+
+	// multiplier of the world gravity, zero flies straight
+	UPROPERTY(EditDefaultsOnly, Category = "Projectile")
+		float GravityScale = 1.0f;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Projectile", meta = (ForceUnits = s))
+		float Lifetime = 3.0f;
+
+	// radius of the sweep, zero traces a line
+	UPROPERTY(EditDefaultsOnly, Category = "Projectile", meta = (ForceUnits = cm))
+		float Radius = 0.0f;
+
+	// applied to the hit actor by the server, the context carries the origin, the hit result and the weapon like hitscan hits do
+	UPROPERTY(EditDefaultsOnly, Category = "Projectile")
+		TSubclassOf<UGameplayEffect> DamageEffect;
+
+	// all projectiles of this type are drawn as instances of this mesh
+	UPROPERTY(EditDefaultsOnly, Category = "Visual")
+		TObjectPtr<UStaticMesh> Mesh;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Visual")
+		FVector MeshScale = FVector::OneVector;
+};
+
+USTRUCT()
+struct FProjectileType
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+		TObjectPtr<const UProjectileDefinition> Definition;
+
+	// one instanced mesh for every projectile of the type, not created where cosmetics don't run
+	UPROPERTY()
+		TObjectPtr<UInstancedStaticMeshComponent> Visuals;
+
+	TArray<FTransform> InstanceTransforms;
+};
+
+/**
+ * Simulates all projectiles of a world as a structure of arrays, there is no actor per projectile.
+ * The integration runs in one vectorized loop, then the sweeps of all projectiles from their previous position are started as one batch
+ * of async traces. The batch is read at the start of the next tick before integrating, so a hit is found one frame after the segment moved.
+ * Damage is only applied where the projectile was spawned with authority. The shooting client simulates its own volley for the look,
+ * the server launches the damaging one from the aim the client sent and multicasts the volley parameters once, see
+ * UEquipmentComponent::MulticastProjectileVolley. The other clients regenerate the pellets and simulate a cosmetic copy.
+ */
+UCLASS()
+class INVENTORYABILITYSYSTEM_API UProjectileSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//~USubsystem interface
+	virtual void Deinitialize() override;
+	//~End of USubsystem interface
+
+	//~FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~End of FTickableGameObject interface
+
+	/** Launches a projectile, the hits are attributed to the weapon and the source ability system.
+	 * Without an authoritative source the projectile is only drawn, the source's avatar is still ignored by the sweep */
+	void SpawnProjectile(const UProjectileDefinition* Definition, const FVector& Location, const FVector& Direction, UWeaponInstance* Weapon, UAbilitySystemComponent* SourceAbilitySystem);
+
+	int32 GetNumProjectiles() const { return PositionX.Num(); }
+
+private:
+	struct FProjectileHit
+	{
+		FHitResult Hit;
+		FVector Origin;
+		uint16 Type;
+		TWeakObjectPtr<UWeaponInstance> Weapon;
+		TWeakObjectPtr<UAbilitySystemComponent> Source;
+	};
+
+	int32 FindOrAddType(const UProjectileDefinition* Definition);
+	void Integrate(float DeltaSeconds);
+	// reads the sweeps started by the last tick and removes the projectiles that hit something or expired
+	void CollectSweepResults(TArray<FProjectileHit>& OutHits);
+	void StartSweeps();
+	void ApplyHit(const FProjectileHit& Hit) const;
+	void UpdateVisuals();
+	void RemoveAtSwap(int32 Index);
+
+	UPROPERTY()
+		TArray<FProjectileType> Types;
+
+	// owns the instanced meshes of the types
+	UPROPERTY()
+		TObjectPtr<AActor> VisualsActor;
+
+	// Kinematics, split per component so the integration can run over four projectiles at once
+	TArray<double> PositionX;
+	TArray<double> PositionY;
+	TArray<double> PositionZ;
+	TArray<double> PreviousX;
+	TArray<double> PreviousY;
+	TArray<double> PreviousZ;
+	TArray<double> VelocityX;
+	TArray<double> VelocityY;
+	TArray<double> VelocityZ;
+	TArray<double> GravityZ;
+	TArray<double> RemainingLifetime;
+
+	// Per projectile data read by the sweep and on hit
+	TArray<FVector> Origins;
+	TArray<uint16> TypeIndices;
+	TArray<TEnumAsByte<ECollisionChannel>> TraceChannels;
+	TArray<uint8> Authoritative;
+	TArray<TWeakObjectPtr<UWeaponInstance>> Weapons;
+	TArray<TWeakObjectPtr<UAbilitySystemComponent>> Sources;
+
+	// async sweep of each projectile started by the last tick, projectiles spawned since then have none.
+	// Results with another batch id belong to an older frame
+	TArray<FTraceHandle> SweepHandles;
+	uint32 SweepBatch = 0;
+};
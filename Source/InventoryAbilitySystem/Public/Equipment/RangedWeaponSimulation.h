@@ -0,0 +1,113 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class URangedWeaponInstance;
+struct FBakedFloatCurve;
+
+// Per weapon configuration copied into the simulation when a weapon is registered
+struct FRangedWeaponSimulationParams
+{
+	const FBakedFloatCurve* HeatToSpreadCurve = nullptr;
+	const FBakedFloatCurve* HeatToCoolDownPerSecondCurve = nullptr;
+
+	float InitialHeat = 0.0f;
+	float MinHeat = 0.0f;
+	float MaxHeat = 0.0f;
+	float MinSpread = 0.0f;
+
+	float TransitionRate_StandingStill = 0.0f;
+	float TransitionRate_Crouching = 0.0f;
+	float TransitionRate_JumpingOrFalling = 0.0f;
+
+	bool bCanOverheat = false;
+};
+
+// Multiplier targets gathered from the pawn every frame
+struct FRangedWeaponMultiplierTargets
+{
+	float StandingStill = 1.0f;
+	float Crouching = 1.0f;
+	float JumpingOrFalling = 1.0f;
+	float Aiming = 1.0f;
+};
+
+/**
+ * Structure of arrays store for the heat and spread state of all ranged weapons in a world.
+ * Weapons in [0, NumAwake) are simulated every frame, the rest are at rest and only polled for a movement change.
+ * The heat cooldown and the multiplier interpolation run in one vectorized kernel over the awake range.
+ * Owned and stepped by UEquipmentTickSubsystem.
+ */
+struct INVENTORYABILITYSYSTEM_API FRangedWeaponSimulation
+{
+public:
+	// Movement state between standing still and moving, weapons never go to sleep in it
+	static constexpr uint8 MovementStateInTransition = 0xFF;
+
+	/** Adds a weapon, returns its index. The index of a weapon changes when others are removed or go to sleep */
+	int32 Add(URangedWeaponInstance* Owner, const FRangedWeaponSimulationParams& Params);
+	void Remove(int32 Index);
+
+	/** Moves a sleeping weapon back into the awake range */
+	void Wake(int32 Index);
+
+	/** Gathers the inputs from the owning weapons and simulates the awake range */
+	void Step(UWorld* World, float DeltaSeconds);
+
+	/** Simulates the awake range with the inputs gathered last, does not touch the owners */
+	void Simulate(float DeltaSeconds);
+
+	/** Adds heat from a shot and wakes the weapon */
+	void AddHeat(int32 Index, float HeatPerShot);
+
+	int32 Num() const { return Owners.Num(); }
+	int32 GetNumAwake() const { return NumAwake; }
+
+	float GetHeat(int32 Index) const { return Heat[Index]; }
+	float GetSpreadAngle(int32 Index) const { return SpreadAngle[Index]; }
+	float GetSpreadAngleMultiplier(int32 Index) const { return CombinedMultiplier[Index]; }
+	bool IsOverheated(int32 Index) const { return Overheated[Index] != 0; }
+
+	/** Overrides the gathered inputs, for driving the simulation without owners. The weapon is kept awake */
+	void SetInputs(int32 Index, const FRangedWeaponMultiplierTargets& Targets, bool bCoolingDown);
+
+private:
+	void Swap(int32 A, int32 B);
+	void RemoveLast();
+	void ClampHeat(int32 Index);
+
+	// Owners, their SimulationIndex is kept in sync with the position in these arrays
+	TArray<TWeakObjectPtr<URangedWeaponInstance>> Owners;
+	int32 NumAwake = 0;
+
+	// State
+	TArray<float> Heat;
+	TArray<float> SpreadAngle;
+	TArray<float> StandingStillMultiplier;
+	TArray<float> CrouchingMultiplier;
+	TArray<float> JumpFallMultiplier;
+	TArray<float> CombinedMultiplier;
+	TArray<uint8> Overheated;
+
+	// Inputs, gathered every frame. The movement state of sleeping weapons is the one they went to sleep with
+	TArray<uint8> MovementState;
+	TArray<uint8> CoolingDown;
+	TArray<float> CoolDownRate;
+	TArray<float> StandingStillTarget;
+	TArray<float> CrouchingTarget;
+	TArray<float> JumpFallTarget;
+	TArray<float> AimingMultiplier;
+
+	// Configuration
+	TArray<const FBakedFloatCurve*> HeatToSpreadCurve;
+	TArray<const FBakedFloatCurve*> HeatToCoolDownPerSecondCurve;
+	TArray<float> MinHeat;
+	TArray<float> MaxHeat;
+	TArray<float> MinSpread;
+	TArray<float> TransitionRate_StandingStill;
+	TArray<float> TransitionRate_Crouching;
+	TArray<float> TransitionRate_JumpingOrFalling;
+	TArray<uint8> CanOverheat;
+};
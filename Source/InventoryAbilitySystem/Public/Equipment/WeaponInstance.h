@@ -6,8 +6,14 @@
 #include "EquipmentInstance.h"
 #include "GameplayTagContainer.h"
 #include "PhysicalMaterials/PhysicalMaterial.h"
+#include "Equipment/BakedFloatCurve.h"
+#include "UObject/ObjectKey.h"
 #include "WeaponInstance.generated.h"
 
+struct FRangedWeaponSimulation;
+class UProjectileDefinition;
+struct FRangedWeaponMultiplierTargets;
+
 UCLASS()
 class UPhysicalMaterialWithTags : public UPhysicalMaterial
 {
@@ -19,6 +25,10 @@ public:
 	// A container of gameplay tags that game code can use to reason about this physical material
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = PhysicalProperties)
 		FGameplayTagContainer Tags;
+
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
 };
 /**
  * 
@@ -35,9 +45,22 @@ public:
 	UFUNCTION(BlueprintPure)
 		float GetDamageAtDistance(float Distance);
 
+	// Multiplier of the MaterialDamageMultiplier tags the material has. Computed once per weapon class and material,
+	// the table lives on the class default object and is shared by every instance
 	UFUNCTION(BlueprintPure)
 		float GetDamageMultiplier(const UPhysicalMaterial* PhysicalMaterial);
 
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+
+	// drops the multiplier tables of every weapon class, called when a multiplier or a material tag is edited
+	static void InvalidateDamageMultiplierCaches() { ++DamageMultiplierCacheSerial; }
+#endif
+
+	//UEquipmentInstance
+	virtual void OnEquipped() override;
+	//End UEquipmentInstance
+
 public:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Animation")
 		UAnimMontage* MeleeAttackMontage;
@@ -53,6 +76,29 @@ protected:
 	// If more than one tag is present, the multipliers will be combined multiplicatively
 	UPROPERTY(EditAnywhere, Category = "Weapon Config")
 		TMap<FGameplayTag, float> MaterialDamageMultiplier;	
+
+	// Upper limit of samples per baked curve
+	UPROPERTY(EditAnywhere, Category = "Weapon Config|Curve Baking", meta = (ClampMin = 2))
+		int32 CurveBakeMaxSamples = 256;
+
+	// Baked curves are resampled with more samples until they are within this error of the source curve
+	UPROPERTY(EditAnywhere, Category = "Weapon Config|Curve Baking", meta = (ClampMin = 0.0))
+		float CurveBakeMaxError = 0.001f;
+
+	FBakedFloatCurve BakedDistanceDamageFalloff;
+
+	// Samples the weapon curves into lookup tables, called on equip
+	virtual void BakeCurves();
+
+private:
+	float ComputeDamageMultiplier(const UPhysicalMaterial* PhysicalMaterial) const;
+
+	// only filled on the class default object, see GetDamageMultiplier
+	mutable TMap<TObjectKey<UPhysicalMaterial>, float> DamageMultiplierCache;
+#if WITH_EDITOR
+	mutable int32 DamageMultiplierCacheBuiltSerial = 0;
+	static int32 DamageMultiplierCacheSerial;
+#endif
 };
 
 UCLASS()
@@ -60,27 +106,19 @@ class INVENTORYABILITYSYSTEM_API URangedWeaponInstance : public UWeaponInstance
 {
 	GENERATED_BODY()
 	friend class UInventoryGameplayAbility_RangedWeapon;
+	friend struct FRangedWeaponSimulation;
 
 private:
-	bool bWasOverheated = false;
-
-	// The current heat
-	float CurrentHeat = 0.0f;
-
-	// The current spread angle (in degrees, diametrical)
-	float CurrentSpreadAngle = 0.0f;
-
-	// The current *combined* spread angle multiplier
-	float CurrentSpreadAngleMultiplier = 1.0f;
+	// Index of the heat and spread state in the world's FRangedWeaponSimulation, INDEX_NONE while not equipped
+	int32 SimulationIndex = INDEX_NONE;
 
-	// The current standing still multiplier
-	float StandingStillMultiplier = 1.0f;
+	FBakedFloatCurve BakedHeatToSpreadCurve;
+	FBakedFloatCurve BakedHeatToHeatPerShotCurve;
+	FBakedFloatCurve BakedHeatToCoolDownPerSecondCurve;
 
-	// The current jumping/falling multiplier
-	float JumpFallMultiplier = 1.0f;
-
-	// The current crouching multiplier
-	float CrouchingMultiplier = 1.0f;
+	// Heat range of the curves, computed when baking
+	float CachedMinHeat = 0.0f;
+	float CachedMaxHeat = 0.0f;
 
 protected:
 	// Multiplier when standing still or moving very slowly
@@ -126,6 +164,10 @@ protected:
 	UPROPERTY(EditAnywhere, Category = "Spread|Fire Params")
 		bool bCanOverheat;
 
+	// Pellets are spread in the cone with this exponent, higher values cluster them around the center
+	UPROPERTY(EditAnywhere, Category = "Spread|Fire Params", meta = (ClampMin = "0.1"))
+		float SpreadExponent = 1.0f;
+
 	// A curve that maps the heat to the spread angle
 	// The X range of this curve typically sets the min/max heat range of the weapon
 	// The Y range of this curve is used to define the min and maximum spread angle
@@ -149,6 +191,14 @@ protected:
 	UPROPERTY(EditAnywhere, Category = "Spread|Fire Params", meta = (ForceUnits = s))
 		float SpreadRecoveryCooldownDelay = 0.0f;
 
+	// Attacks per minute of automatic fire, see UInventoryGameplayAbility_RangedWeapon::StartAutomaticFire
+	UPROPERTY(EditAnywhere, Category = "Fire Rate", meta = (ClampMin = 1.0))
+		float RoundsPerMinute = 600.0f;
+
+	// Attacks that came due in one frame past this are dropped, bounds the burst after a hitch
+	UPROPERTY(EditAnywhere, Category = "Fire Rate", meta = (ClampMin = 1))
+		int32 MaxAttacksPerFrame = 4;
+
 	// Number of attacks to fire in a attack (typically 1, but may be more for eg. shotguns)
 	UPROPERTY(EditAnywhere, Category = "Hit Detection")
 		int32 HitsPerAttack = 1;
@@ -159,27 +209,51 @@ protected:
 	UPROPERTY(EditAnywhere, Category = "Hit Detection")
 		float HitTraceRadius = 0.f;
 
+	// muzzle relative to the first cosmetic actor of the definition, used where that actor isn't spawned (cosmetic actors on dedicated servers)
+	UPROPERTY(EditAnywhere, Category = "Hit Detection")
+		FTransform MuzzleProxyOffset;
+
+	// fired by UInventoryGameplayAbility_RangedWeapon::FireProjectiles instead of tracing the pellets
+	UPROPERTY(EditAnywhere, Category = "Hit Detection")
+		TObjectPtr<const UProjectileDefinition> ProjectileDefinition;
+
 public:
 	URangedWeaponInstance(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
 
-	virtual void Tick(float DeltaSeconds) override;
-
 	//UEquipmentInstance
 	virtual void OnEquipped() override;
+	virtual void OnUnequipped() override;
 	//End UEquipmentInstance
 	void AddSpread();
 
+protected:
+	virtual void BakeCurves() override;
+
+public:
+
 	UFUNCTION(BlueprintPure)
 		float GetSpreadAngle(bool bIgnoreMultiplier);
 
+	UFUNCTION(BlueprintPure)
+		float GetSpreadExponent() const { return SpreadExponent; }
+
 	UFUNCTION(BlueprintPure)
 		float GetHeat() const;
 
+	UFUNCTION(BlueprintPure)
+		bool IsOverheated() const;
+
+	// muzzle socket of the equipment actors, resolved once after they change so targeting doesn't search actors or sockets per shot
 	UFUNCTION(BlueprintPure)
 		FTransform GetMuzzleTransform() const;
 	UFUNCTION(BlueprintPure)
 		FVector GetMuzzleLocation() const;
 
+	// seconds between two attacks of automatic fire
+	UFUNCTION(BlueprintPure)
+		float GetFireInterval() const { return 60.0f / FMath::Max(RoundsPerMinute, 1.0f); }
+	int32 GetMaxAttacksPerFrame() const { return FMath::Max(MaxAttacksPerFrame, 1); }
+
 	UFUNCTION(BlueprintPure)
 		int32 GetHitsPerAttack() const;
 	UFUNCTION(BlueprintPure)
@@ -187,30 +261,36 @@ public:
 	ECollisionChannel GetTraceChannel() const;
 	UFUNCTION(BlueprintPure)
 		float GetHitTraceRadius() const;
+	const UProjectileDefinition* GetProjectileDefinition() const { return ProjectileDefinition; }
 
 private:
 	void ComputeHeatRange(float& MinHeat, float& MaxHeat);
-	inline float ClampHeat(float NewHeat)
+
+	//UEquipmentInstance
+	virtual void OnEquipmentActorsChanged() override;
+	//End UEquipmentInstance
+
+	// finds the component and socket of the muzzle, or where it would be if the first cosmetic actor of the definition was spawned
+	void ResolveMuzzle() const;
+	// points the muzzle at Socket of Component, sockets on bones are evaluated from the bone every call
+	void SetMuzzle(const USceneComponent* Component, FName Socket, const FTransform& Offset) const;
+
+	FRangedWeaponSimulation* GetSimulation() const;
+
+	// Computes the multiplier targets for the current movement of the pawn
+	void GatherMultiplierTargets(FRangedWeaponMultiplierTargets& OutTargets) const;
+
+	// Packs the movement conditions the multipliers depend on, a change wakes the weapon up
+	uint8 GetMovementState() const;
+
+	struct FMuzzleCache
 	{
-		float MinHeat;
-		float MaxHeat;
-		ComputeHeatRange(/*out*/ MinHeat, /*out*/ MaxHeat);
-
-		if (bCanOverheat) {
-			if (bWasOverheated) {
-				bWasOverheated = NewHeat <= MinHeat;
-			}
-			else {
-				bWasOverheated = NewHeat >= MaxHeat;
-			}
-		}
-
-		return FMath::Clamp(NewHeat, MinHeat, MaxHeat);
-	}
-
-	// Updates the spread and returns true if the spread is at minimum
-	bool UpdateSpread(float DeltaSeconds);
-
-	//// Updates the multipliers and returns true if they are at minimum
-	bool UpdateMultipliers(float DeltaSeconds);
+		TWeakObjectPtr<const USceneComponent> Component;
+		// bone of a skinned component the socket follows, INDEX_NONE for sockets fixed to the component
+		int32 BoneIndex = INDEX_NONE;
+		// socket relative to the bone or the component
+		FTransform Relative;
+		bool bResolved = false;
+	};
+	mutable FMuzzleCache MuzzleCache;
 };
@@ -124,6 +124,23 @@ class UInventoryFragment_WeaponItem : public UInventoryFragment_EquippableItem
 	GENERATED_BODY()
 };
 
+// body slots an equipped item takes, items sharing a slot can't be equipped at the same time
+UCLASS()
+class UInventoryFragment_BodySlots : public UInventoryItemFragment
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (Bitmask, BitmaskEnum = "/Script/InventoryAbilitySystem.EInventoryArmorCategory"))
+		int32 ArmorSlots = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (Bitmask, BitmaskEnum = "/Script/InventoryAbilitySystem.EInventoryAccessoirCategory"))
+		int32 AccessoirSlots = 0;
+
+	// armor slots in bits 0-7, accessoir slots in bits 8-15
+	uint32 GetSlotMask() const { return (uint32)(ArmorSlots & 0xFF) | ((uint32)(AccessoirSlots & 0xFF) << 8); }
+};
+
 UCLASS()
 class UInventoryFragment_SetStats : public UInventoryItemFragment
 {
@@ -240,6 +257,13 @@ public:
 	UFUNCTION(BlueprintCallable)
 		void RemoveAllItems();
 
+	// tops the inventory up to the loadout and makes the equipment slots match it, items already in their slot are left alone
+	// and slotted items the loadout doesn't equip are taken off
+	void ApplyLoadout(TConstArrayView<FLoadout> loadout);
+
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly)
+		void ApplyLoadoutPreset(const class ULoadoutPreset* preset);
+
 	// if no category, returns all items
 	UFUNCTION(BlueprintCallable)
 		TArray<FInventoryEntry> GetItems(TSubclassOf<UInventoryFragment_EquippableItem> type) const;
@@ -11,15 +11,40 @@
 UE_DECLARE_GAMEPLAY_TAG_EXTERN(TAG_Cosmetic_AnimationStyle);
 UE_DECLARE_GAMEPLAY_TAG_EXTERN(TAG_Cosmetic_BodyStyle);
 
+// cosmetic tags filtered by a prefix, the hash doesn't depend on the tag order so equal sets from different pawns share it
+struct INVENTORYABILITYSYSTEM_API FCosmeticTagSet
+{
+	FGameplayTagContainer Tags;
+	uint32 Hash = 0;
+
+	void Build(const FGameplayTagContainer& SourceTags, FGameplayTag RequiredPrefix);
+};
+
 UCLASS()
 class INVENTORYABILITYSYSTEM_API UInventoryCosmeticComponent : public UPawnComponent
 {
 	GENERATED_BODY()
 
-public:
+protected:
 	UPROPERTY(EditAnywhere, Category = "Animation")
 		FGameplayTagContainer AnimationStyleTags;
 
+	// prefix -> AnimationStyleTags filtered by it, cleared when the tags change
+	mutable TMap<FGameplayTag, FCosmeticTagSet> filteredTags;
+
+public:
+	UFUNCTION(BlueprintCallable, Category = "Animation")
+		void SetAnimationStyleTags(const FGameplayTagContainer& NewTags);
+
+	const FGameplayTagContainer& GetAnimationStyleTags() const { return AnimationStyleTags; }
+
+	// tags matching RequiredPrefix, all tags if the prefix is not valid
 	FGameplayTagContainer GetCombinedTags(FGameplayTag RequiredPrefix) const;
-	
+
+	// same as GetCombinedTags without the copy, the reference is only valid until the next call
+	const FCosmeticTagSet& GetFilteredTags(FGameplayTag RequiredPrefix) const;
+
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
 };
@@ -97,6 +97,9 @@ private:
 	FGameplayTagStackContainer StatTags;
 	TSubclassOf<UInventoryItemDefinition> itemDef;
 
+	mutable uint32 bodySlotMask = 0;
+	mutable bool bBodySlotMaskCached = false;
+
 public:
 	// Adds a specified number of stacks to the tag (does nothing if StackCount is below 1)
 	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = Inventory)
@@ -131,11 +134,15 @@ public:
 		return (ResultClass*)FindFragmentByClass(ResultClass::StaticClass());
 	}
 
+	// body slots the item takes when equipped, see UInventoryFragment_BodySlots. Looked up once, slot checks are a mask test
+	uint32 GetBodySlotMask() const;
+
 private:
 	friend class UInventoryComponent;
 	void SetItemDef(TSubclassOf<UInventoryItemDefinition> inItemDef)
 	{
 		itemDef = inItemDef;
+		bBodySlotMaskCached = false;
 	}
 
 };
@@ -0,0 +1,23 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "Inventory/InventoryComponent.h"
+#include "LoadoutPreset.generated.h"
+
+/**
+ * ULoadoutPreset
+ *
+ *	Items a pawn starts with, applied in one batch by UInventoryComponent::ApplyLoadout.
+ */
+UCLASS(BlueprintType)
+class INVENTORYABILITYSYSTEM_API ULoadoutPreset : public UPrimaryDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Loadout")
+		TArray<FLoadout> Items;
+};
@@ -18,6 +18,10 @@ private:
 	UPROPERTY(EditDefaultsOnly, Category = "Setup")
 		TArray<struct FLoadout> initialLoadout;
 
+	// applied together with initialLoadout as one batch
+	UPROPERTY(EditDefaultsOnly, Category = "Setup")
+		TObjectPtr<const class ULoadoutPreset> loadoutPreset;
+
 	UPROPERTY(EditDefaultsOnly, Category = "Setup")
 		TObjectPtr<class UInventoryInputConfig> initialInputConfig;
 
@@ -38,6 +42,7 @@ public:
 	AAbilityCharacter();
 
 	//Begin AActor Interface
+	virtual void BeginPlay() override;
 	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	//End AActor Interface
 
@@ -16,6 +16,10 @@ private:
 	UPROPERTY(EditDefaultsOnly, Category = "Setup")
 		TArray<struct FLoadout> initialLoadout;
 
+	// applied together with initialLoadout as one batch
+	UPROPERTY(EditDefaultsOnly, Category = "Setup")
+		TObjectPtr<const class ULoadoutPreset> loadoutPreset;
+
 	UPROPERTY(EditDefaultsOnly, Category = "Setup")
 		TObjectPtr<class UInventoryInputConfig> initialInputConfig;
 
@@ -36,6 +40,7 @@ public:
 	AAbilityPawn();
 
 	//Begin AActor Interface
+	virtual void BeginPlay() override;
 	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	//End AActor Interface
 